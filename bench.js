@@ -0,0 +1,447 @@
+/**
+ * zstd_native benchmark suite
+ *
+ * Sweeps payload size x level x concurrency over generated corpora (or the
+ * files of a corpus directory such as Silesia) and reports throughput,
+ * per-operation latency percentiles and memory use. Results are printed as
+ * a table and can be written as JSON to compare builds. A second table gives
+ * the per-call cost of the async calls for inputs small enough to be handled
+ * on the calling thread and for inputs just above that size:
+ *
+ *   npm run bench -- --json results.json
+ *   npm run bench -- --corpus ./silesia --compare baseline.json
+ */
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const {
+    zstdCompress,
+    zstdDecompress,
+    zstdCompressSync,
+    zstdDecompressSync,
+    getLimits
+} = require('./index.js');
+
+const USAGE = `Usage: node bench.js [options]
+  --sizes <list>        Payload sizes, e.g. 1k,64k,1m (default: 1k,64k,1m,8m)
+  --levels <list>       Compression levels (default: 1,3,9,19)
+  --concurrency <list>  Operations kept in flight (default: 1,4,<cpus>)
+  --corpus <name|dir>   text, json, random, or a directory of files (default: text,json)
+  --time <ms>           Measuring time per case (default: 500)
+  --warmup <n>          Untimed operations per case (default: 3)
+  --json <file>         Write machine-readable results to <file> ('-' for stdout)
+  --compare <file>      Report regressions against a previous --json run
+  --threshold <pct>     Throughput drop counted as a regression (default: 10)
+  --overhead <list>     Sizes timed in ns per call, async vs. sync
+                        (default: 64,256,1k,1025,2k; '' to skip)`;
+
+// Inputs up to this size are compressed and decompressed inline by the async
+// calls (SMALL_INPUT_SIZE in zstd_native.cpp); larger ones go to a worker
+const INLINE_LIMIT = 1024;
+
+function parseSize(text) {
+    const match = /^(\d+(?:\.\d+)?)([kmg]?)b?$/i.exec(text.trim());
+    if (!match) {
+        throw new Error(`Invalid size: ${text}`);
+    }
+    const scale = { '': 1, k: 1024, m: 1024 * 1024, g: 1024 * 1024 * 1024 }[match[2].toLowerCase()];
+    return Math.round(Number(match[1]) * scale);
+}
+
+function formatSize(bytes) {
+    for (const [unit, scale] of [['g', 1 << 30], ['m', 1 << 20], ['k', 1 << 10]]) {
+        if (bytes >= scale && bytes % scale === 0) {
+            return `${bytes / scale}${unit}`;
+        }
+    }
+    return String(bytes);
+}
+
+function parseArgs(argv) {
+    const options = {
+        sizes: [1 << 10, 64 << 10, 1 << 20, 8 << 20],
+        levels: [1, 3, 9, 19],
+        concurrency: [...new Set([1, 4, os.cpus().length])],
+        corpora: ['text', 'json'],
+        time: 500,
+        warmup: 3,
+        json: null,
+        compare: null,
+        threshold: 10,
+        overhead: [64, 256, 1 << 10, (1 << 10) + 1, 2 << 10]
+    };
+    const list = (value, parse) => value.split(',').filter(Boolean).map(parse);
+    for (let i = 0; i < argv.length; i++) {
+        const name = argv[i];
+        const value = argv[i + 1];
+        if (name === '--help' || name === '-h') {
+            console.log(USAGE);
+            process.exit(0);
+        }
+        if (value === undefined) {
+            throw new Error(`Missing value for ${name}\n${USAGE}`);
+        }
+        i++;
+        switch (name) {
+            case '--sizes': options.sizes = list(value, parseSize); break;
+            case '--levels': options.levels = list(value, Number); break;
+            case '--concurrency': options.concurrency = list(value, Number); break;
+            case '--corpus': options.corpora = list(value, String); break;
+            case '--time': options.time = Number(value); break;
+            case '--warmup': options.warmup = Number(value); break;
+            case '--json': options.json = value; break;
+            case '--compare': options.compare = value; break;
+            case '--threshold': options.threshold = Number(value); break;
+            case '--overhead': options.overhead = list(value, parseSize); break;
+            default: throw new Error(`Unknown option ${name}\n${USAGE}`);
+        }
+    }
+    return options;
+}
+
+// Deterministic generator so runs are comparable between builds
+function random(seed) {
+    let state = seed >>> 0;
+    return () => {
+        state ^= state << 13;
+        state >>>= 0;
+        state ^= state >>> 17;
+        state ^= state << 5;
+        state >>>= 0;
+        return state / 0x100000000;
+    };
+}
+
+const WORDS = ('the of and to in is that for it as was with be by on not he this are or his from at which ' +
+    'but have an they you were her she there been one all we their has would when if so no will ' +
+    'compression stream frame window dictionary level buffer context entropy literal match offset').split(' ');
+
+// Skewed word stream with punctuation and line breaks, roughly as
+// compressible as the prose files of the Silesia corpus
+function textCorpus(size) {
+    const next = random(0x5eed);
+    const parts = [];
+    let length = 0;
+    while (length < size) {
+        const word = WORDS[Math.floor(WORDS.length * next() * next())];
+        const piece = next() < 0.08 ? `${word}.\n` : `${word} `;
+        parts.push(piece);
+        length += piece.length;
+    }
+    return Buffer.from(parts.join('')).subarray(0, size);
+}
+
+// Newline-delimited API records, the typical small-message payload
+function jsonCorpus(size) {
+    const next = random(0x15011);
+    const parts = [];
+    let length = 0;
+    for (let id = 0; length < size; id++) {
+        const record = JSON.stringify({
+            id,
+            user: `user${Math.floor(next() * 5000)}`,
+            action: WORDS[Math.floor(next() * WORDS.length)],
+            ok: next() < 0.9,
+            latency: Math.round(next() * 20000) / 100,
+            tags: [WORDS[Math.floor(next() * 20)], WORDS[Math.floor(next() * 20)]]
+        }) + '\n';
+        parts.push(record);
+        length += record.length;
+    }
+    return Buffer.from(parts.join('')).subarray(0, size);
+}
+
+function randomCorpus(size) {
+    const next = random(0xbad5eed);
+    const buffer = Buffer.allocUnsafe(size);
+    for (let i = 0; i < size; i++) {
+        buffer[i] = Math.floor(next() * 256);
+    }
+    return buffer;
+}
+
+const GENERATORS = { text: textCorpus, json: jsonCorpus, random: randomCorpus };
+
+// Payloads of a corpus directory are cut from the concatenated files,
+// repeating them when a size exceeds the whole corpus
+function directoryCorpus(dir) {
+    const files = fs.readdirSync(dir)
+        .map(name => path.join(dir, name))
+        .filter(file => fs.statSync(file).isFile())
+        .sort();
+    if (files.length === 0) {
+        throw new Error(`No files in corpus directory ${dir}`);
+    }
+    const all = Buffer.concat(files.map(file => fs.readFileSync(file)));
+    if (all.length === 0) {
+        throw new Error(`Corpus directory ${dir} is empty`);
+    }
+    return size => {
+        const times = Math.ceil(size / all.length);
+        return (times > 1 ? Buffer.concat(new Array(times).fill(all)) : all).subarray(0, size);
+    };
+}
+
+function corpusSource(name) {
+    if (GENERATORS[name]) {
+        return GENERATORS[name];
+    }
+    if (fs.existsSync(name) && fs.statSync(name).isDirectory()) {
+        return directoryCorpus(name);
+    }
+    throw new Error(`Unknown corpus ${name}: expected ${Object.keys(GENERATORS).join(', ')} or a directory`);
+}
+
+// Latencies in nanoseconds; fixed log2 buckets keep histograms comparable
+function summarize(samples) {
+    const sorted = BigUint64Array.from(samples).sort();
+    const at = q => Number(sorted[Math.min(sorted.length - 1, Math.floor(q * sorted.length))]) / 1000;
+    const histogram = {};
+    for (const sample of sorted) {
+        const micros = Number(sample) / 1000;
+        const bucket = micros < 1 ? 1 : 2 ** Math.ceil(Math.log2(micros));
+        histogram[bucket] = (histogram[bucket] || 0) + 1;
+    }
+    return {
+        p50: at(0.5),
+        p90: at(0.9),
+        p99: at(0.99),
+        max: Number(sorted[sorted.length - 1]) / 1000,
+        histogramUs: histogram
+    };
+}
+
+// Keeps `concurrency` operations in flight until `time` ms have passed
+async function measure(op, concurrency, time, warmup) {
+    for (let i = 0; i < warmup; i++) {
+        await op();
+    }
+    if (global.gc) {
+        global.gc();
+    }
+    const before = process.memoryUsage();
+    const cpuBefore = process.cpuUsage();
+    const samples = [];
+    let peakRss = before.rss;
+    const start = process.hrtime.bigint();
+    const deadline = start + BigInt(Math.round(time * 1e6));
+
+    // Every lane completes at least one operation, however short the time
+    const lane = async () => {
+        do {
+            const t0 = process.hrtime.bigint();
+            await op();
+            samples.push(process.hrtime.bigint() - t0);
+            if (samples.length % 16 === 0) {
+                peakRss = Math.max(peakRss, process.memoryUsage.rss());
+            }
+        } while (process.hrtime.bigint() < deadline);
+    };
+    await Promise.all(Array.from({ length: concurrency }, lane));
+
+    const elapsed = Number(process.hrtime.bigint() - start) / 1e9;
+    const after = process.memoryUsage();
+    const cpu = process.cpuUsage(cpuBefore);
+    return {
+        ops: samples.length,
+        seconds: elapsed,
+        latencyUs: summarize(samples),
+        cpuSeconds: (cpu.user + cpu.system) / 1e6,
+        memory: {
+            peakRss: Math.max(peakRss, after.rss),
+            rssDelta: after.rss - before.rss,
+            externalDelta: after.external - before.external,
+            arrayBuffersDelta: after.arrayBuffers - before.arrayBuffers
+        }
+    };
+}
+
+function caseKey(result) {
+    return `${result.corpus}/${result.op}/${formatSize(result.size)}/L${result.level}/c${result.concurrency}`;
+}
+
+async function run(options) {
+    const results = [];
+    if (Math.max(...options.sizes) > getLimits().maxInputSize) {
+        throw new Error('Largest size exceeds the addon input limit');
+    }
+
+    for (const corpus of options.corpora) {
+        const source = corpusSource(corpus);
+        for (const size of options.sizes) {
+            const input = source(size);
+            for (const level of options.levels) {
+                const compressed = zstdCompressSync(input, level);
+                const ops = {
+                    compress: () => zstdCompress(input, level),
+                    decompress: () => zstdDecompress(compressed)
+                };
+                // The sync calls show the per-call cost the promise adds;
+                // they cannot overlap, so they only run at concurrency 1
+                const syncOps = {
+                    compressSync: () => zstdCompressSync(input, level),
+                    decompressSync: () => zstdDecompressSync(compressed)
+                };
+                for (const concurrency of options.concurrency) {
+                    const caseOps = concurrency === 1 ? { ...ops, ...syncOps } : ops;
+                    for (const [op, fn] of Object.entries(caseOps)) {
+                        const stats = await measure(fn, concurrency, options.time, options.warmup);
+                        const result = {
+                            corpus: path.basename(corpus),
+                            op,
+                            size,
+                            level,
+                            concurrency,
+                            ratio: input.length / compressed.length,
+                            throughputMBs: stats.ops * size / stats.seconds / (1024 * 1024),
+                            opsPerSec: stats.ops / stats.seconds,
+                            ...stats
+                        };
+                        results.push(result);
+                        printRow(result);
+                    }
+                }
+            }
+        }
+    }
+    return results;
+}
+
+// Mean wall time per call of a sequential loop: one call in flight, so the
+// async figure is the sync work plus what the promise and any thread hop add
+async function perCall(op, time, warmup) {
+    for (let i = 0; i < warmup; i++) {
+        await op();
+    }
+    let calls = 0;
+    const start = process.hrtime.bigint();
+    const deadline = start + BigInt(Math.round(time * 1e6));
+    do {
+        for (let i = 0; i < 64; i++) {
+            await op();
+        }
+        calls += 64;
+    } while (process.hrtime.bigint() < deadline);
+    return Number(process.hrtime.bigint() - start) / calls;
+}
+
+async function runOverhead(options) {
+    const results = [];
+    if (options.overhead.length === 0) {
+        return results;
+    }
+    console.log(`
+${'overhead'.padEnd(24)} ${'path'.padStart(6)} ${'async ns'.padStart(10)} ` +
+        `${'sync ns'.padStart(10)} ${'extra ns'.padStart(10)}`);
+    const source = corpusSource('text');
+    for (const size of options.overhead) {
+        const input = source(size);
+        const compressed = zstdCompressSync(input);
+        const pairs = {
+            compress: [() => zstdCompress(input), () => zstdCompressSync(input)],
+            decompress: [() => zstdDecompress(compressed), () => zstdDecompressSync(compressed)]
+        };
+        for (const [op, [asyncOp, syncOp]] of Object.entries(pairs)) {
+            // Decompression goes inline by the compressed size
+            const inline = (op === 'compress' ? input : compressed).length <= INLINE_LIMIT;
+            const asyncNs = await perCall(asyncOp, options.time, options.warmup);
+            const syncNs = await perCall(syncOp, options.time, options.warmup);
+            const result = { op, size, inline, asyncNs, syncNs, extraNs: asyncNs - syncNs };
+            results.push(result);
+            console.log([
+                `${op}/${formatSize(size)}`.padEnd(24),
+                (inline ? 'inline' : 'worker').padStart(6),
+                asyncNs.toFixed(0).padStart(10),
+                syncNs.toFixed(0).padStart(10),
+                result.extraNs.toFixed(0).padStart(10)
+            ].join(' '));
+        }
+    }
+    return results;
+}
+
+function printHeader() {
+    console.log(['case'.padEnd(36), 'MB/s'.padStart(9), 'ops/s'.padStart(10), 'p50 us'.padStart(10),
+        'p99 us'.padStart(10), 'ratio'.padStart(7), 'peak RSS'.padStart(10)].join(' '));
+}
+
+function printRow(result) {
+    console.log([
+        caseKey(result).padEnd(36),
+        result.throughputMBs.toFixed(1).padStart(9),
+        result.opsPerSec.toFixed(0).padStart(10),
+        result.latencyUs.p50.toFixed(1).padStart(10),
+        result.latencyUs.p99.toFixed(1).padStart(10),
+        result.ratio.toFixed(2).padStart(7),
+        `${(result.memory.peakRss / (1024 * 1024)).toFixed(0)}M`.padStart(10)
+    ].join(' '));
+}
+
+// Returns the number of cases whose throughput dropped past the threshold
+function compare(results, baselineFile, threshold) {
+    const baseline = JSON.parse(fs.readFileSync(baselineFile, 'utf8'));
+    const previous = new Map(baseline.results.map(result => [caseKey(result), result]));
+    let regressions = 0;
+    console.log(`\nCompared with ${baselineFile} (${baseline.version}, ${baseline.date}):`);
+    for (const result of results) {
+        const old = previous.get(caseKey(result));
+        if (!old) {
+            continue;
+        }
+        const change = (result.throughputMBs / old.throughputMBs - 1) * 100;
+        if (change < -threshold) {
+            regressions++;
+            console.log(`  REGRESSION ${caseKey(result)}: ${old.throughputMBs.toFixed(1)} -> ` +
+                `${result.throughputMBs.toFixed(1)} MB/s (${change.toFixed(1)}%)`);
+        }
+    }
+    if (regressions === 0) {
+        console.log(`  No throughput drop beyond ${threshold}%`);
+    }
+    return regressions;
+}
+
+async function main() {
+    const options = parseArgs(process.argv.slice(2));
+    const toStdout = options.json === '-';
+    const log = console.log;
+    if (toStdout) {
+        // Keep stdout clean for the JSON document
+        console.log = (...args) => console.error(...args);
+    }
+
+    printHeader();
+    const results = await run(options);
+    const overhead = await runOverhead(options);
+    const report = {
+        version: require('./package.json').version,
+        date: new Date().toISOString(),
+        node: process.version,
+        platform: `${os.platform()} ${os.arch()}`,
+        cpus: os.cpus().length,
+        cpuModel: (os.cpus()[0] || {}).model,
+        threadpoolSize: Number(process.env.UV_THREADPOOL_SIZE) || 4,
+        options: { ...options, json: undefined, compare: undefined },
+        results,
+        overhead
+    };
+
+    if (options.json) {
+        const text = JSON.stringify(report, null, 2);
+        if (toStdout) {
+            log(text);
+        } else {
+            fs.writeFileSync(options.json, text + '\n');
+            console.log(`\nWrote ${results.length} results to ${options.json}`);
+        }
+    }
+    if (options.compare && compare(results, options.compare, options.threshold) > 0) {
+        process.exitCode = 1;
+    }
+}
+
+main().catch(error => {
+    console.error(error.message);
+    process.exit(2);
+});
@@ -7,30 +7,523 @@
 
 /// <reference types="node" />
 
+import { Transform, TransformOptions } from 'stream';
+import { ReadableStream, WritableStream } from 'stream/web';
+
+/**
+ * Binary input accepted by every compression and decompression entry point.
+ * Views are read in place at their byte offset; a SharedArrayBuffer lets
+ * worker threads hand data to the addon without copying it.
+ */
+export type BytesLike = Buffer | NodeJS.TypedArray | DataView | ArrayBuffer | SharedArrayBuffer;
+
+/**
+ * Dictionary digested once into ZSTD_CDict/ZSTD_DDict form and shared by
+ * every call (and worker thread) it is passed to.
+ */
+export class Dictionary {
+    /**
+     * @param buffer - Dictionary content, e.g. from `zstd --train` or trainDictionary()
+     * @param level - Compression level the dictionary is digested for, default: 3
+     * @throws {Error} If the buffer is empty or the level is out of range
+     */
+    constructor(buffer: BytesLike, level?: number);
+
+    /** Dictionary ID from the header, 0 for raw content dictionaries */
+    readonly id: number;
+    /** Dictionary size in bytes */
+    readonly size: number;
+    /** Default compression level for calls using this dictionary */
+    readonly level: number;
+}
+
+export interface TrainDictionaryOptions {
+    /** fastCover segment size, 0 = search */
+    k?: number;
+    /** fastCover dmer size (6-16), 0 = search {6, 8} */
+    d?: number;
+    /** log2 of the frequency array size, 0 = default (20) */
+    f?: number;
+    /** Number of parameter combinations tried, 0 = default */
+    steps?: number;
+    /** Acceleration (1-10), higher is faster and less accurate */
+    accel?: number;
+    /** Fraction of samples used for training, the rest for evaluation (0, 1] */
+    splitPoint?: number;
+    /** Training threads, only effective when libzstd was built multithreaded */
+    threads?: number;
+    /** Compression level the dictionary is tuned for; selects fastCover */
+    level?: number;
+    /** Dictionary ID to embed, 0 = random; selects fastCover */
+    dictID?: number;
+}
+
+/**
+ * Train a dictionary from samples on the libuv threadpool.
+ * Without options ZDICT_trainFromBuffer is used; any of k, d, f, steps,
+ * accel, splitPoint, threads, level or dictID selects
+ * ZDICT_optimizeTrainFromBuffer_fastCover.
+ * @param samples - Representative samples
+ * @param capacity - Maximum dictionary size in bytes (at least 256)
+ * @param options - Training parameters
+ * @returns Promise with the dictionary content
+ * @throws {Error} If there are too few samples or training fails
+ */
+export function trainDictionary(samples: BytesLike[], capacity: number, options?: TrainDictionaryOptions): Promise<Buffer>;
+
+/**
+ * Adaptive level control, similar to `zstd --adapt`. The level starts at
+ * `level` and moves one step at a time (skipping 0) from the measured cost of
+ * recent calls or stream steps. At least one target is required.
+ */
+export interface AdaptOptions {
+    /** Lowest level to use, default: -7 */
+    minLevel?: number;
+    /** Highest level to use, default: 19 */
+    maxLevel?: number;
+    /** Minimum compression speed in MB/s (10^6 bytes) of input */
+    targetThroughput?: number;
+    /** Maximum time per call or stream step, in milliseconds */
+    maxLatency?: number;
+}
+
+export interface CompressOptions {
+    /** Compression level (MIN_LEVEL..MAX_LEVEL, negative = fast), default: the dictionary's level or 3 */
+    level?: number;
+    /** Pre-digested dictionary */
+    dictionary?: Dictionary;
+    /**
+     * Choose the level from throughput/latency targets. State is kept per
+     * Compressor, stream or batch call; a one-shot call only uses the
+     * starting level.
+     */
+    adapt?: AdaptOptions;
+    /**
+     * Compression worker threads (ZSTD_c_nbWorkers), or 'auto' to pick a count
+     * from the input size (one per 8MB, up to the core count). Ignored when
+     * libzstd was built without multithreading, see MAX_WORKERS. Default: 0.
+     */
+    workers?: number | 'auto';
+    /** Bytes per worker job (ZSTD_c_jobSize), 0 = automatic */
+    jobSize?: number;
+    /** Overlap between jobs (ZSTD_c_overlapLog, 0-9), 0 = automatic */
+    overlapLog?: number;
+    /**
+     * Store input whose frame would be larger than the input itself as a 0x00
+     * marker byte followed by the input. Such output is not a zstd frame; it
+     * decompresses only with `rawFallback: true`. Default: false.
+     */
+    rawFallback?: boolean;
+
+    // Advanced parameters, named after ZSTD_c_*. 0 selects the library default;
+    // other values are checked against ZSTD_cParam_getBounds.
+
+    /** Maximum back-reference distance as a power of 2 */
+    windowLog?: number;
+    hashLog?: number;
+    chainLog?: number;
+    searchLog?: number;
+    minMatch?: number;
+    targetLength?: number;
+    /** ZSTD_strategy value (1-9) or its name */
+    strategy?: number | 'fast' | 'dfast' | 'greedy' | 'lazy' | 'lazy2' | 'btlazy2' | 'btopt' | 'btultra' | 'btultra2';
+    /** Aim for compressed blocks of about this size, for lower latency on lossy links */
+    targetCBlockSize?: number;
+    /** Long distance matching for inputs with repeats far apart */
+    enableLongDistanceMatching?: boolean;
+    ldmHashLog?: number;
+    ldmMinMatch?: number;
+    ldmBucketSizeLog?: number;
+    ldmHashRateLog?: number;
+    /** Write the content size into the frame header, default: true */
+    contentSizeFlag?: boolean;
+    /** Append a 32-bit content checksum to each frame, default: false */
+    checksumFlag?: boolean;
+    /** Write the dictionary ID into the frame header, default: true */
+    dictIDFlag?: boolean;
+}
+
+export interface DecompressOptions {
+    /** Dictionary the data was compressed with */
+    dictionary?: Dictionary;
+    /** Accept input stored by `rawFallback` compression, default: false */
+    rawFallback?: boolean;
+    /**
+     * Do not verify `checksumFlag` checksums (ZSTD_d_forceIgnoreChecksum),
+     * for input from a trusted source. Default: false
+     */
+    ignoreChecksum?: boolean;
+}
+
+export type DigestAlgorithm = 'xxh64' | 'crc32c';
+
+/**
+ * Hash of the output computed while it is produced, so no second pass over
+ * it is needed. Reported as big-endian hex, as xxhsum and crc32c tools print
+ * it; CRC32C uses the SSE4.2 or ARMv8 CRC instructions when available.
+ */
+export interface DigestOptions {
+    digest?: DigestAlgorithm;
+}
+
+/** Result of a decompression with `digest` */
+export interface DigestedBuffer {
+    buffer: Buffer;
+    digest: string;
+}
+
+/**
+ * Cancellation of one asynchronous call (and deadlines for synchronous
+ * ones). The work is done in steps of about 128 KiB of input (compression)
+ * or 1 MiB of output (decompression) and stops at the next step, freeing
+ * its partial output. The Promise rejects with an Error named AbortError
+ * (code ABORT_ERR, cause: the signal's reason) or TimeoutError (code ETIMEDOUT).
+ */
+export interface CancelOptions {
+    /** Abort the call when this signal fires */
+    signal?: AbortSignal;
+    /** Give up this many milliseconds after the call, time spent queued included */
+    deadlineMs?: number;
+}
+
 /**
  * Compress data using zstd
- * @param buffer - Data to compress (must be a Buffer)
- * @param level - Compression level (1-22), default: 3
- * @returns Promise with compressed Buffer
- * @throws {Error} If input is not a Buffer or compression fails
+ * @param buffer - Data to compress
+ * @param options - Compression level (MIN_LEVEL..MAX_LEVEL) or options, default: 3
+ * @returns Promise with compressed Buffer, computed on the libuv threadpool
+ * @throws {Error} If input is not binary data or compression fails
  * @throws {Error} If input size exceeds maximum allowed size
  * @throws {Error} If output would exceed maximum allowed size
  */
-export function zstdCompress(buffer: Buffer, level?: number): Promise<Buffer>;
+export function zstdCompress(buffer: BytesLike, options?: number | (CompressOptions & CancelOptions)): Promise<Buffer>;
 
 /**
  * Decompress zstd compressed data
- * @param buffer - Compressed data to decompress (must be a Buffer)
+ * Every frame is decoded, including concatenated frames and frames without
+ * a declared content size (e.g. from `zstd` in a pipe or a stream); the
+ * output for those grows as needed up to the output size limit. Seekable
+ * data (see compressSeekable) is decoded in parallel across the threadpool.
+ * @param buffer - Compressed data to decompress
+ * @param options - Decompression options
  * @returns Promise with decompressed Buffer
- * @throws {Error} If input is not a Buffer or decompression fails
+ * @throws {Error} If input is not binary data or decompression fails
  * @throws {Error} If input size exceeds maximum allowed size
  * @throws {Error} If decompressed size would exceed maximum allowed size
- * @throws {Error} If compressed data is invalid or size unknown
+ * @throws {Error} If compressed data is invalid or truncated
+ */
+export function zstdDecompress(buffer: BytesLike, options?: DecompressOptions & CancelOptions & { digest?: undefined }): Promise<Buffer>;
+export function zstdDecompress(buffer: BytesLike, options: DecompressOptions & CancelOptions & { digest: DigestAlgorithm }): Promise<DigestedBuffer>;
+
+/**
+ * Compress data using zstd, blocking the calling thread
+ * @param buffer - Data to compress
+ * @param options - Compression level (MIN_LEVEL..MAX_LEVEL) or options, default: 3
+ * @returns Compressed Buffer
+ * @throws {Error} If input is not binary data or compression fails
+ * @throws {Error} If input or output size exceeds maximum allowed size
+ */
+export function zstdCompressSync(buffer: BytesLike, options?: number | (CompressOptions & CancelOptions)): Buffer;
+
+/**
+ * Decompress zstd compressed data, blocking the calling thread
+ * @param buffer - Compressed data to decompress
+ * @param options - Decompression options
+ * @returns Decompressed Buffer
+ * @throws {Error} If input is not binary data or decompression fails
+ * @throws {Error} If input or decompressed size exceeds maximum allowed size
+ */
+export function zstdDecompressSync(buffer: BytesLike, options?: DecompressOptions & CancelOptions & { digest?: undefined }): Buffer;
+export function zstdDecompressSync(buffer: BytesLike, options: DecompressOptions & CancelOptions & { digest: DigestAlgorithm }): DigestedBuffer;
+
+/** Memory that compressInto/decompressInto may write into */
+export type WritableBytes = Buffer | NodeJS.TypedArray | DataView | ArrayBuffer | SharedArrayBuffer;
+
+/**
+ * Compress into caller-supplied memory, blocking the calling thread.
+ * Nothing is allocated; size dst with compressBound(). With `rawFallback`
+ * the input is stored instead when its frame would be larger, or when only
+ * the stored form (input length + 1 bytes) fits dst.
+ * @param buffer - Data to compress
+ * @param dst - Destination memory
+ * @param offset - Byte offset into dst, default: 0
+ * @param options - Compression level (MIN_LEVEL..MAX_LEVEL) or options, default: 3
+ * @returns Number of bytes written
+ * @throws {Error} If dst is too small or compression fails
  */
-export function zstdDecompress(buffer: Buffer): Promise<Buffer>;
+export function compressInto(buffer: BytesLike, dst: WritableBytes, offset?: number, options?: number | CompressOptions): number;
 
 /**
- * Set maximum allowed input size
+ * Decompress every frame into caller-supplied memory, blocking the calling thread.
+ * With `rawFallback`, stored input is copied into dst.
+ * @param buffer - Compressed data
+ * @param dst - Destination memory
+ * @param offset - Byte offset into dst, default: 0
+ * @param options - Decompression options
+ * @returns Number of bytes written
+ * @throws {Error} If dst is too small or the data is invalid
+ */
+export function decompressInto(buffer: BytesLike, dst: WritableBytes, offset?: number, options?: DecompressOptions): number;
+
+export interface FileOptions {
+    /** Output window written per write() call, 64 bytes to 64MB, default: 1 MiB */
+    chunkSize?: number;
+}
+
+export interface FileResult {
+    bytesRead: number;
+    bytesWritten: number;
+    /** With the digest option: hash of the file written to dst */
+    digest?: string;
+}
+
+/**
+ * Compress the file at src into dst on the libuv threadpool. Regular files
+ * are memory-mapped; I/O and compression stay in native code and memory is
+ * bounded by the output window. The size limits do not apply, and a failed
+ * call removes the partial destination.
+ * @param src - Source path
+ * @param dst - Destination path, created or truncated
+ * @param options - Compression level or options, default: 3
+ */
+export function compressFile(src: string, dst: string, options?: number | (CompressOptions & FileOptions & CancelOptions & DigestOptions)): Promise<FileResult>;
+
+/**
+ * Decompress the file at src into dst on the libuv threadpool; see compressFile.
+ * Accepts concatenated frames and frames without a content size.
+ */
+export function decompressFile(src: string, dst: string, options?: DecompressOptions & FileOptions & CancelOptions & DigestOptions): Promise<FileResult>;
+
+/**
+ * Compress buffer against base, which is referenced in place as a raw-content
+ * prefix (ZSTD_CCtx_refPrefix), like `zstd --patch-from`. When the base is
+ * larger than the level's window, windowLog is raised to cover base + buffer
+ * and long-distance matching is enabled unless the options set them.
+ * Neither buffer may be modified until the Promise settles.
+ * @param buffer - New version
+ * @param base - Previous version, needed again by decompressDelta
+ * @param options - Compression level or options without a dictionary, default: 3
+ */
+export function compressDelta(buffer: BytesLike, base: BytesLike, options?: number | CompressOptions): Promise<Buffer>;
+
+/**
+ * Decompress output of compressDelta using the same base. Frames made
+ * against a large base may use windows beyond the default decoder limit,
+ * which is raised to cover the base plus the output size limit.
+ */
+export function decompressDelta(buffer: BytesLike, base: BytesLike): Promise<Buffer>;
+
+export interface SeekableOptions extends CompressOptions {
+    /** Uncompressed bytes per independent frame, at most 1 GiB, default: 1 MiB */
+    frameSize?: number;
+}
+
+/**
+ * Compress into the zstd seekable format: independent frames plus a seek
+ * table in a trailing skippable frame. The output is still valid zstd data.
+ * With checksumFlag the frame checksums are recorded in the seek table.
+ * Ranges of frames are compressed in parallel on the libuv threadpool, and
+ * zstdDecompress decodes such data in parallel as well.
+ * @param buffer - Data to compress
+ * @param options - Compression level or options, default: 3
+ */
+export function compressSeekable(buffer: BytesLike, options?: number | SeekableOptions): Promise<Buffer>;
+
+/**
+ * Decompress content bytes [offset, offset + length) of seekable data,
+ * decoding only the frames that overlap the range. The input is read in
+ * place and is not subject to the input size limit.
+ * @param buffer - Seekable compressed data
+ * @param offset - Offset into the uncompressed content
+ * @param length - Bytes to read, clipped at the end, default: to the end
+ * @param options - Decompression options
+ * @throws {Error} If the seek table is missing or invalid, or offset is past the end
+ */
+export function readRange(buffer: BytesLike, offset: number, length?: number, options?: DecompressOptions): Promise<Buffer>;
+
+/**
+ * Same as readRange(), blocking the calling thread
+ */
+export function readRangeSync(buffer: BytesLike, offset: number, length?: number, options?: DecompressOptions): Buffer;
+
+/** Batch results as one block; item i is buffer.subarray(offsets[i], offsets[i + 1]) */
+export interface ContiguousBatch {
+    buffer: Buffer;
+    /** items.length + 1 offsets into buffer */
+    offsets: number[];
+}
+
+export interface BatchOptions {
+    /** Resolve to one contiguous Buffer plus an offsets table, default: false */
+    contiguous?: boolean;
+}
+
+/**
+ * Compress many Buffers in one native call, spread over the libuv threadpool.
+ * A failing item rejects the whole batch with "Item <index>: ...".
+ * @param buffers - Data to compress
+ * @param options - Compression level or options, default: 3
+ * @returns Compressed Buffers in input order
+ */
+export function compressBatch(buffers: BytesLike[], options?: number | (CompressOptions & CancelOptions & { contiguous?: false })): Promise<Buffer[]>;
+export function compressBatch(buffers: BytesLike[], options: CompressOptions & CancelOptions & { contiguous: true }): Promise<ContiguousBatch>;
+export function compressBatch(buffers: BytesLike[], options?: number | (CompressOptions & BatchOptions & CancelOptions)): Promise<Buffer[] | ContiguousBatch>;
+
+/**
+ * Decompress many Buffers in one native call, spread over the libuv threadpool.
+ * @param buffers - Compressed data
+ * @param options - Decompression options
+ * @returns Decompressed Buffers in input order
+ */
+export function decompressBatch(buffers: BytesLike[], options?: DecompressOptions & CancelOptions & { contiguous?: false }): Promise<Buffer[]>;
+export function decompressBatch(buffers: BytesLike[], options: DecompressOptions & CancelOptions & { contiguous: true }): Promise<ContiguousBatch>;
+export function decompressBatch(buffers: BytesLike[], options?: DecompressOptions & BatchOptions & CancelOptions): Promise<Buffer[] | ContiguousBatch>;
+
+/**
+ * Worst-case compressed size for an input of the given size
+ * @param size - Input size in bytes
+ */
+export function compressBound(size: number): number;
+
+/** Per-instance size caps; unset caps follow setMaxInputSize/setMaxOutputSize */
+export interface InstanceLimits {
+    maxInputSize?: number;
+    maxOutputSize?: number;
+}
+
+/**
+ * Compressor owning a reusable compression context.
+ * Only one operation may be in flight at a time; overlapping calls fail.
+ */
+export class Compressor {
+    /**
+     * @param options - Compression level (MIN_LEVEL..MAX_LEVEL) or options, default: 3
+     * @throws {Error} If level is out of range
+     */
+    constructor(options?: number | (CompressOptions & InstanceLimits));
+
+    /** Compression level used by this instance */
+    readonly level: number;
+
+    /**
+     * Compress data on the libuv threadpool
+     * @param buffer - Data to compress
+     * @returns Promise with compressed Buffer
+     */
+    compress(buffer: BytesLike): Promise<Buffer>;
+
+    /**
+     * Compress data, blocking the calling thread
+     * @param buffer - Data to compress
+     * @returns Compressed Buffer
+     */
+    compressSync(buffer: BytesLike): Buffer;
+}
+
+/**
+ * Decompressor owning a reusable decompression context.
+ * Only one operation may be in flight at a time; overlapping calls fail.
+ */
+export class Decompressor {
+    constructor(options?: DecompressOptions & InstanceLimits);
+
+    /**
+     * Decompress data on the libuv threadpool
+     * @param buffer - Compressed data to decompress
+     * @returns Promise with decompressed Buffer
+     */
+    decompress(buffer: BytesLike): Promise<Buffer>;
+
+    /**
+     * Decompress data, blocking the calling thread
+     * @param buffer - Compressed data to decompress
+     * @returns Decompressed Buffer
+     */
+    decompressSync(buffer: BytesLike): Buffer;
+}
+
+export interface ZstdCompressOptions extends TransformOptions, CompressOptions {
+    /** Output window size in bytes, default: ZSTD_CStreamOutSize() */
+    chunkSize?: number;
+}
+
+export interface ZstdDecompressOptions extends TransformOptions, DecompressOptions {
+    /** Skip checksumFlag verification for a trusted source, default: false */
+    ignoreChecksum?: boolean;
+    /** Output window size in bytes, default: ZSTD_DStreamOutSize() */
+    chunkSize?: number;
+}
+
+/**
+ * Transform stream compressing with ZSTD_compressStream2.
+ * Memory stays bounded by the output window regardless of payload size.
+ */
+export class ZstdCompress extends Transform {
+    constructor(options?: ZstdCompressOptions);
+    /** Flush buffered input so everything written so far can be decoded */
+    flush(callback?: (error?: Error | null) => void): void;
+}
+
+/**
+ * Transform stream decompressing with ZSTD_decompressStream.
+ * Accepts frames of unknown content size and concatenated frames.
+ */
+export class ZstdDecompress extends Transform {
+    constructor(options?: ZstdDecompressOptions);
+    flush(callback?: (error?: Error | null) => void): void;
+}
+
+export function createZstdCompress(options?: ZstdCompressOptions): ZstdCompress;
+export function createZstdDecompress(options?: ZstdDecompressOptions): ZstdDecompress;
+
+export interface ChunkCompressOptions extends CompressOptions {
+    /** Output window size in bytes, default: ZSTD_CStreamOutSize() */
+    chunkSize?: number;
+}
+
+export interface ChunkDecompressOptions extends DecompressOptions {
+    /** Skip checksumFlag verification for a trusted source, default: false */
+    ignoreChecksum?: boolean;
+    /** Output window size in bytes, default: ZSTD_DStreamOutSize() */
+    chunkSize?: number;
+}
+
+/**
+ * Compress the chunks of an iterable into a zstd stream. Each output window
+ * is produced when the generator is pulled, so at most one is buffered.
+ */
+export function compressChunks(
+    source: Iterable<BytesLike | string> | AsyncIterable<BytesLike | string>,
+    options?: ChunkCompressOptions
+): AsyncGenerator<Buffer, void, undefined>;
+
+/** Decompress the chunks of an iterable, see compressChunks */
+export function decompressChunks(
+    source: Iterable<BytesLike> | AsyncIterable<BytesLike>,
+    options?: ChunkDecompressOptions
+): AsyncGenerator<Buffer, void, undefined>;
+
+/**
+ * WHATWG transform stream compressing with ZSTD_compressStream2, usable
+ * where a CompressionStream is, e.g. `body.pipeThrough(new ZstdCompressionStream())`.
+ * Output is produced as the readable side is read; a write settles once its
+ * chunk has been drained.
+ */
+export class ZstdCompressionStream {
+    constructor(options?: ChunkCompressOptions);
+    readonly readable: ReadableStream<Buffer>;
+    readonly writable: WritableStream<BytesLike>;
+}
+
+/** WHATWG transform stream decompressing with ZSTD_decompressStream */
+export class ZstdDecompressionStream {
+    constructor(options?: ChunkDecompressOptions);
+    readonly readable: ReadableStream<Buffer>;
+    readonly writable: WritableStream<BytesLike>;
+}
+
+/**
+ * Set maximum allowed input size. Limits are per environment: the main
+ * thread and each worker_thread have their own.
  * @param size - Maximum size in bytes (default: 2GB)
  * @throws {Error} If size is negative or too large
  */
@@ -44,7 +537,7 @@ export function setMaxInputSize(size: number): void;
 export function setMaxOutputSize(size: number): void;
 
 /**
- * Get current size limits
+ * Get the size limits of the calling thread
  * @returns Object with maxInputSize and maxOutputSize properties
  */
 export function getLimits(): {
@@ -52,17 +545,237 @@ export function getLimits(): {
     maxOutputSize: number;
 };
 
+/** Metadata of one zstd frame, from its header */
+export interface ZstdFrameInfo {
+    type: 'zstd';
+    /** Byte offset of the frame in the buffer */
+    offset: number;
+    compressedSize: number;
+    headerSize: number;
+    /** Declared content size, or null if the header omits it */
+    contentSize: number | null;
+    /** Memory the decoder needs for back-references */
+    windowSize: number;
+    blockSizeMax: number;
+    /** 0 if the frame names no dictionary */
+    dictionaryId: number;
+    /** Whether the frame ends with a content checksum */
+    checksum: boolean;
+}
+
+/** A skippable frame, e.g. the seek table of compressSeekable output */
+export interface SkippableFrameInfo {
+    type: 'skippable';
+    offset: number;
+    compressedSize: number;
+    headerSize: number;
+    /** Size of the skippable payload */
+    contentSize: number;
+    /** Low 4 bits of the magic number (0-15) */
+    magicVariant: number;
+    /** Whether this is a seekable-format seek table */
+    seekTable: boolean;
+}
+
+export interface FrameInfo {
+    frames: Array<ZstdFrameInfo | SkippableFrameInfo>;
+    compressedSize: number;
+    /** Total content size, or null if any zstd frame omits its size */
+    contentSize: number | null;
+}
+
 /**
- * Minimum supported compression level
+ * Describe every frame of the buffer using ZSTD_getFrameHeader,
+ * ZSTD_findFrameCompressedSize and ZSTD_getDictID_fromFrame. Synchronous and
+ * cheap: nothing is decoded and no output is allocated.
+ * @throws {Error} If the data is not a sequence of complete frames
+ */
+export function getFrameInfo(buffer: BytesLike): FrameInfo;
+
+/** Work done by libzstd in one direction */
+export interface CodecStats {
+    /** One-shot calls, stream steps and seekable frames that completed */
+    calls: number;
+    bytesIn: number;
+    bytesOut: number;
+    /** Wall time spent inside libzstd */
+    nanoseconds: number;
+}
+
+export interface Stats {
+    compress: CodecStats;
+    decompress: CodecStats;
+    /** Uses of the per-thread pooled contexts; a miss creates the context */
+    contextPool: {
+        compressHits: number;
+        compressMisses: number;
+        decompressHits: number;
+        decompressMisses: number;
+    };
+    /** Asynchronous jobs queued or running right now */
+    queueDepth: number;
+    peakQueueDepth: number;
+    /** Largest single output block allocated, in bytes */
+    peakOutputAllocation: number;
+    /** Output blocks recycled (hits) or allocated (misses) by configureBufferPool's pool */
+    bufferPool: {
+        hits: number;
+        misses: number;
+        idleBytes: number;
+    };
+    threadPool: ThreadPoolStats;
+}
+
+/** Jobs per priority class of configureThreadPool's pool */
+export interface ThreadPoolClasses {
+    latency: number;
+    bulk: number;
+}
+
+export interface ThreadPoolStats {
+    /** 0 while the libuv threadpool is used */
+    threads: number;
+    latencyThreads: number;
+    latencyJobSize: number;
+    /** Waiting for a thread right now */
+    queued: ThreadPoolClasses;
+    running: number;
+    completed: ThreadPoolClasses;
+    /** Jobs a thread took from another thread's queue */
+    steals: number;
+}
+
+/**
+ * Process-wide native counters, summed over every thread and environment.
+ * Counters are monotonic, suitable for Prometheus counters; queueDepth is
+ * a gauge.
+ */
+export function getStats(): Stats;
+
+/** Native memory charged to the budget, in bytes */
+export interface MemoryUsage {
+    /** 0 when no budget is set */
+    budget: number;
+    total: number;
+    /** Pooled and owned compression/decompression contexts and stream buffers */
+    contexts: number;
+    /** Digested dictionaries and their content */
+    dictionaries: number;
+    /** Output buffers being filled, before they are handed to JS */
+    buffers: number;
+    /** Highest total seen */
+    peak: number;
+    /** Allocations refused because they would pass the budget */
+    rejected: number;
+}
+
+/**
+ * Cap native memory across the process: contexts (sized ahead with
+ * ZSTD_estimateCCtxSize_usingCCtxParams / ZSTD_estimateDCtxSize), dictionaries
+ * and in-flight output buffers. A call whose next allocation would pass the
+ * budget rejects with a "Memory budget" error instead of allocating it.
+ * @param bytes - Budget, or 0 for none (the default)
+ */
+export function setMemoryBudget(bytes: number): void;
+
+export function getMemoryUsage(): MemoryUsage;
+
+export interface MemoryEstimate {
+    /** One-shot compression context (zstdCompress and friends) */
+    compress: number;
+    /** Compression context with stream buffers (streams, compressFile) */
+    compressStream: number;
+    decompress: number;
+    /** Decompression context with buffers for the window these options produce */
+    decompressStream: number;
+}
+
+/**
+ * Context memory the options need, without allocating anything. Pass the
+ * input size when known: unknown sizes are estimated for the worst case.
+ */
+export function estimateMemory(options?: number | CompressOptions, size?: number): MemoryEstimate;
+
+export interface ContextArenaOptions extends CompressOptions {
+    /** Largest input the pooled contexts must handle; default: unknown (worst case) */
+    maxInputSize?: number;
+    /** Threads to reserve slots for; default: UV_THREADPOOL_SIZE + 1 */
+    slots?: number;
+}
+
+export interface ContextArena {
+    slots: number;
+    compressSlotSize: number;
+    decompressSlotSize: number;
+    /** Total size of the arena, charged to the memory budget */
+    bytes: number;
+}
+
+/**
+ * Place every thread's pooled contexts in slots of one arena with
+ * ZSTD_initStaticCCtx / ZSTD_initStaticDCtx, for a fixed footprint and no
+ * allocation inside libzstd. Slots are sized for the options (the highest
+ * level the pool will serve); calls that need more fail, and workers are not
+ * available on pooled contexts. Threads beyond the slots keep heap contexts.
+ * Can be called once per process.
+ */
+export function configureContextArena(options?: number | ContextArenaOptions): ContextArena;
+
+export interface BufferPoolOptions {
+    /** Idle blocks to keep, in bytes; 0 turns the pool off. Default: 0 */
+    maxIdleBytes?: number;
+    /** Largest output block that is pooled, default: 4 MiB */
+    maxBlockSize?: number;
+}
+
+/**
+ * Recycle output blocks in power-of-two classes so steady-state calls do not
+ * allocate. A block returns to the pool when its Buffer is collected.
+ * Omit the options to turn the pool off and free idle blocks.
+ */
+export function configureBufferPool(options?: BufferPoolOptions): void;
+
+export interface ThreadPoolOptions {
+    /** Pool size, default: one per CPU; 0 returns to the libuv threadpool */
+    threads?: number;
+    /** Threads that run only small jobs; default 1 with two or more threads */
+    latencyThreads?: number;
+    /** Largest input, in bytes, queued as a small job. Default: 64 KiB */
+    latencyJobSize?: number;
+    /** CPUs to pin the threads to, thread i on affinity[i % length] (Linux only) */
+    affinity?: number[];
+}
+
+export interface ThreadPoolConfig {
+    threads: number;
+    latencyThreads: number;
+    latencyJobSize: number;
+}
+
+/**
+ * Run the asynchronous calls on native threads of the addon's own, so they
+ * neither wait behind nor hold up fs and dns work on the libuv threadpool.
+ * Small jobs are queued ahead of bulk ones, and idle threads steal from busy
+ * ones. The pool is process-wide and can only be reconfigured while idle.
+ */
+export function configureThreadPool(options?: ThreadPoolOptions): ThreadPoolConfig;
+
+/**
+ * Minimum supported compression level (ZSTD_minCLevel(), negative)
  */
 export const MIN_LEVEL: number;
 
 /**
- * Maximum supported compression level
+ * Maximum supported compression level (ZSTD_maxCLevel())
  */
 export const MAX_LEVEL: number;
 
 /**
  * Default compression level
  */
-export const DEFAULT_LEVEL: number;
\ No newline at end of file
+export const DEFAULT_LEVEL: number;
+
+/**
+ * Maximum accepted workers value; 0 when libzstd lacks multithreading support
+ */
+export const MAX_WORKERS: number;
\ No newline at end of file
@@ -4,45 +4,653 @@
  * Author: kzolti (Zoltan Istvan KADA)
  */
 
+const { Transform } = require('stream');
 const addon = require('./build/Release/zstd_native.node');
 
+// Written through the stream by flush() so it stays ordered with data chunks
+const kFlushMarker = Buffer.alloc(0);
+const kEmpty = Buffer.alloc(0);
+
+/**
+ * @typedef {Buffer|TypedArray|DataView|ArrayBuffer|SharedArrayBuffer} BytesLike
+ * Views are read at their byte offset without copying
+ */
+
 /**
  * Compress data using zstd
- * @param {Buffer} buffer - Data to compress
- * @param {number} [level=3] - Compression level (1-22)
+ * The work runs on the libuv threadpool; the input must not be modified
+ * until the returned Promise settles. Inputs up to 1 KiB are compressed on
+ * the calling thread, where the round trip would cost more than the work,
+ * and the returned Promise is then already settled. That is skipped when
+ * there is setup to do first: a dictionary at a level it has not been used
+ * with yet, workers or adapt.
+ * @param {BytesLike} buffer - Data to compress
+ * @param {number|Object} [options=3] - Compression level (MIN_LEVEL..MAX_LEVEL) or options
+ * @param {number} [options.level] - Compression level, default: dictionary level or 3
+ * @param {Dictionary} [options.dictionary] - Pre-digested dictionary
+ * @param {number|string} [options.workers=0] - ZSTD_c_nbWorkers, or 'auto' to pick from the input size
+ * @param {number} [options.jobSize] - ZSTD_c_jobSize in bytes when workers are used
+ * @param {number} [options.overlapLog] - ZSTD_c_overlapLog (0-9) when workers are used
+ * @param {boolean} [options.rawFallback=false] - Store input that does not compress behind a 0x00
+ *   marker byte instead of as a frame; decompress it with { rawFallback: true }
+ * @param {AbortSignal} [options.signal] - Stop the work when aborted; rejects with an AbortError
+ * @param {number} [options.deadlineMs] - Stop the work this many ms after the call; rejects
+ *   with a TimeoutError. Cancellable calls compress in steps of 128 KiB of input.
+ * @param {number} [options.windowLog] - ZSTD_c_windowLog; other ZSTD_c_* parameters use their
+ *   names as well, see index.d.ts. Values are checked with ZSTD_cParam_getBounds.
  * @returns {Promise<Buffer>} Compressed data
- * @throws {Error} If input is not a Buffer or compression fails
+ * @throws {Error} If input is not binary data or compression fails
  */
-function zstdCompress(buffer, level) {
-    return new Promise((resolve, reject) => {
+function zstdCompress(buffer, options) {
+    try {
+        return addon.zstdCompress(buffer, options);
+    } catch (error) {
+        return Promise.reject(error);
+    }
+}
+
+/**
+ * Decompress zstd compressed data
+ * All frames are decoded; frames without a content size are decoded into
+ * output that grows up to the output size limit.
+ * The work runs on the libuv threadpool; the input must not be modified
+ * until the returned Promise settles. Input up to 1 KiB whose frames declare
+ * at most 16 KiB of content is decoded on the calling thread, and the
+ * returned Promise is then already settled.
+ * @param {BytesLike} buffer - Compressed data to decompress
+ * @param {Object} [options]
+ * @param {Dictionary} [options.dictionary] - Dictionary the data was compressed with
+ * @param {boolean} [options.rawFallback=false] - Also accept input stored by { rawFallback }
+ * @param {boolean} [options.ignoreChecksum=false] - Skip verifying the frames' checksumFlag
+ *   checksums (ZSTD_d_forceIgnoreChecksum), for input from a trusted source
+ * @param {string} [options.digest] - 'xxh64' or 'crc32c': also hash the output in the same
+ *   pass, decoding in steps of 128 KiB on one thread; resolves to { buffer, digest }
+ * @param {AbortSignal} [options.signal] - Stop the work when aborted, see zstdCompress
+ * @param {number} [options.deadlineMs] - Stop the work this many ms after the call; cancellable
+ *   calls decode in steps of 1 MiB of output, on one thread
+ * @returns {Promise<Buffer|{buffer: Buffer, digest: string}>} Decompressed data
+ * @throws {Error} If input is not binary data or decompression fails
+ */
+function zstdDecompress(buffer, options) {
+    try {
+        return addon.zstdDecompress(buffer, options);
+    } catch (error) {
+        return Promise.reject(error);
+    }
+}
+
+/**
+ * Compress data using zstd on the calling thread
+ * @param {BytesLike} buffer - Data to compress
+ * @param {number|Object} [options=3] - Compression level or options, see zstdCompress
+ * @returns {Buffer} Compressed data
+ * @throws {Error} If input is not binary data or compression fails
+ */
+function zstdCompressSync(buffer, options) {
+    return addon.zstdCompressSync(buffer, options);
+}
+
+/**
+ * Decompress zstd compressed data on the calling thread
+ * @param {BytesLike} buffer - Compressed data to decompress
+ * @param {Object} [options] - See zstdDecompress
+ * @returns {Buffer|{buffer: Buffer, digest: string}} Decompressed data
+ * @throws {Error} If input is not binary data or decompression fails
+ */
+function zstdDecompressSync(buffer, options) {
+    return addon.zstdDecompressSync(buffer, options);
+}
+
+/**
+ * Compress into caller-supplied memory on the calling thread
+ * Nothing is allocated; use compressBound() to size the destination.
+ * With rawFallback the input is stored when that is smaller or only it fits.
+ * @param {BytesLike} buffer - Data to compress
+ * @param {Buffer|TypedArray|DataView|ArrayBuffer|SharedArrayBuffer} dst - Destination memory
+ * @param {number} [offset=0] - Byte offset into dst
+ * @param {number|Object} [options=3] - Compression level or options, see zstdCompress
+ * @returns {number} Number of bytes written
+ * @throws {Error} If arguments are invalid or dst is too small
+ */
+function compressInto(buffer, dst, offset, options) {
+    return addon.compressInto(buffer, dst, offset, options);
+}
+
+/**
+ * Decompress into caller-supplied memory on the calling thread
+ * All frames in buffer are decoded back to back starting at offset;
+ * with rawFallback, stored input is copied there.
+ * @param {BytesLike} buffer - Compressed data
+ * @param {Buffer|TypedArray|DataView|ArrayBuffer|SharedArrayBuffer} dst - Destination memory
+ * @param {number} [offset=0] - Byte offset into dst
+ * @param {Object} [options] - See zstdDecompress
+ * @returns {number} Number of bytes written
+ * @throws {Error} If arguments are invalid, data is corrupt or dst is too small
+ */
+function decompressInto(buffer, dst, offset, options) {
+    return addon.decompressInto(buffer, dst, offset, options);
+}
+
+/**
+ * Train a dictionary from samples on the libuv threadpool
+ * Without options this uses ZDICT_trainFromBuffer. Passing any of k, d, f,
+ * steps, accel, splitPoint, threads, level or dictID uses
+ * ZDICT_optimizeTrainFromBuffer_fastCover, which searches parameters left at 0.
+ * @param {BytesLike[]} samples - Representative samples
+ * @param {number} capacity - Maximum dictionary size in bytes
+ * @param {Object} [options] - fastCover parameters plus level and dictID
+ * @returns {Promise<Buffer>} Dictionary content, usable with new Dictionary()
+ */
+function trainDictionary(samples, capacity, options) {
+    try {
+        return addon.trainDictionary(samples, capacity, options);
+    } catch (error) {
+        return Promise.reject(error);
+    }
+}
+
+/**
+ * Compress a file into another file on the libuv threadpool
+ * All I/O happens in native code: regular files are memory-mapped, other
+ * sources are read in 1 MiB blocks, and output is written one window at a
+ * time, so no data passes through the JS heap. The size limits do not apply.
+ * A failed call removes the partial destination file.
+ * @param {string} src - Source path
+ * @param {string} dst - Destination path, created or truncated
+ * @param {number|Object} [options=3] - Compression level or options, see zstdCompress
+ * @param {number} [options.chunkSize=1048576] - Output window written per write()
+ * @param {string} [options.digest] - 'xxh64' or 'crc32c' of the written file, as it is written
+ * @returns {Promise<{bytesRead: number, bytesWritten: number, digest?: string}>}
+ */
+function compressFile(src, dst, options) {
+    try {
+        return addon.compressFile(src, dst, options);
+    } catch (error) {
+        return Promise.reject(error);
+    }
+}
+
+/**
+ * Decompress a file into another file on the libuv threadpool, see compressFile
+ * @param {string} src - Source path
+ * @param {string} dst - Destination path, created or truncated
+ * @param {Object} [options] - See zstdDecompress, plus chunkSize; digest covers the written file
+ * @returns {Promise<{bytesRead: number, bytesWritten: number, digest?: string}>}
+ */
+function decompressFile(src, dst, options) {
+    try {
+        return addon.decompressFile(src, dst, options);
+    } catch (error) {
+        return Promise.reject(error);
+    }
+}
+
+/**
+ * Compress data against a base version on the libuv threadpool
+ * The base is referenced in place (ZSTD_CCtx_refPrefix), so data similar to
+ * it compresses to little more than the differences. When the base is larger
+ * than the level's window, the window is widened to cover it and
+ * long-distance matching is enabled, unless the options set those parameters.
+ * Neither buffer may be modified until the returned Promise settles.
+ * @param {BytesLike} buffer - New version to compress
+ * @param {BytesLike} base - Previous version; the same bytes are needed to decompress
+ * @param {number|Object} [options=3] - Compression level or options, see zstdCompress;
+ *   a dictionary is not accepted
+ * @returns {Promise<Buffer>} A single zstd frame that only decodes with base
+ */
+function compressDelta(buffer, base, options) {
+    try {
+        return addon.compressDelta(buffer, base, options);
+    } catch (error) {
+        return Promise.reject(error);
+    }
+}
+
+/**
+ * Decompress output of compressDelta on the libuv threadpool
+ * @param {BytesLike} buffer - Compressed delta
+ * @param {BytesLike} base - The base it was compressed against
+ * @returns {Promise<Buffer>} The new version
+ */
+function decompressDelta(buffer, base) {
+    try {
+        return addon.decompressDelta(buffer, base);
+    } catch (error) {
+        return Promise.reject(error);
+    }
+}
+
+/**
+ * Compress into the zstd seekable format on the libuv threadpool
+ * The input is cut into independent frames followed by a seek table, so
+ * readRange() can decode parts of it; the result is still plain zstd data.
+ * @param {BytesLike} buffer - Data to compress
+ * @param {number|Object} [options=3] - Compression level or options, see zstdCompress
+ * @param {number} [options.frameSize=1048576] - Uncompressed bytes per frame, at most 1 GiB
+ * @returns {Promise<Buffer>} Seekable compressed data
+ */
+function compressSeekable(buffer, options) {
+    try {
+        return addon.compressSeekable(buffer, options);
+    } catch (error) {
+        return Promise.reject(error);
+    }
+}
+
+/**
+ * Decompress part of seekable data on the libuv threadpool
+ * Only the frames overlapping the range are decoded. The input is read in
+ * place, so it may be a Buffer over memory-mapped file contents.
+ * @param {BytesLike} buffer - Data from compressSeekable or another seekable writer
+ * @param {number} offset - Offset into the uncompressed content
+ * @param {number} [length] - Bytes to read, clipped at the end; default: to the end
+ * @param {Object} [options] - See zstdDecompress
+ * @returns {Promise<Buffer>} The uncompressed bytes of the range
+ */
+function readRange(buffer, offset, length, options) {
+    try {
+        return addon.readRange(buffer, offset, length, options);
+    } catch (error) {
+        return Promise.reject(error);
+    }
+}
+
+/**
+ * Decompress part of seekable data on the calling thread, see readRange
+ * @returns {Buffer} The uncompressed bytes of the range
+ */
+function readRangeSync(buffer, offset, length, options) {
+    return addon.readRangeSync(buffer, offset, length, options);
+}
+
+/**
+ * Compress many Buffers in one native call
+ * The items are spread over the libuv threadpool, each job using that
+ * thread's pooled context; options are parsed once for the whole batch.
+ * @param {BytesLike[]} buffers - Data to compress
+ * @param {number|Object} [options=3] - Compression level or options, see zstdCompress
+ * @param {boolean} [options.contiguous=false] - Resolve to { buffer, offsets } instead of an array
+ * @returns {Promise<Buffer[]|{buffer: Buffer, offsets: number[]}>} Compressed items; with
+ *   contiguous, item i is buffer.subarray(offsets[i], offsets[i + 1])
+ */
+function compressBatch(buffers, options) {
+    try {
+        return addon.compressBatch(buffers, options);
+    } catch (error) {
+        return Promise.reject(error);
+    }
+}
+
+/**
+ * Decompress many Buffers in one native call, see compressBatch
+ * @param {BytesLike[]} buffers - Compressed data
+ * @param {Object} [options] - See zstdDecompress, plus contiguous
+ * @returns {Promise<Buffer[]|{buffer: Buffer, offsets: number[]}>} Decompressed items
+ */
+function decompressBatch(buffers, options) {
+    try {
+        return addon.decompressBatch(buffers, options);
+    } catch (error) {
+        return Promise.reject(error);
+    }
+}
+
+/**
+ * Compressor owning a reusable native compression context
+ * Only one operation may be in flight at a time.
+ * @param {number|Object} [options=3] - Compression level or options, see zstdCompress
+ */
+class Compressor extends addon.Compressor {
+    /**
+     * Compress data on the libuv threadpool
+     * @param {BytesLike} buffer - Data to compress
+     * @returns {Promise<Buffer>} Compressed data
+     */
+    compress(buffer) {
         try {
-            const result = addon.zstdCompress(buffer, level);
-            resolve(result);
+            return super.compress(buffer);
         } catch (error) {
-            reject(error);
+            return Promise.reject(error);
         }
-    });
+    }
 }
 
 /**
- * Decompress zstd compressed data
- * @param {Buffer} buffer - Compressed data to decompress
- * @returns {Promise<Buffer>} Decompressed data
- * @throws {Error} If input is not a Buffer or decompression fails
+ * Decompressor owning a reusable native decompression context
+ * Only one operation may be in flight at a time.
+ * @param {Object} [options] - See zstdDecompress
  */
-function zstdDecompress(buffer) {
-    return new Promise((resolve, reject) => {
+class Decompressor extends addon.Decompressor {
+    /**
+     * Decompress data on the libuv threadpool
+     * @param {BytesLike} buffer - Compressed data to decompress
+     * @returns {Promise<Buffer>} Decompressed data
+     */
+    decompress(buffer) {
         try {
-            const result = addon.zstdDecompress(buffer);
-            resolve(result);
+            return super.decompress(buffer);
         } catch (error) {
-            reject(error);
+            return Promise.reject(error);
+        }
+    }
+}
+
+/**
+ * Shared Transform plumbing for the native streaming handles
+ * Each native step fills at most one output window (chunkSize bytes), so
+ * memory stays bounded no matter how large the payload is.
+ */
+class ZstdTransform extends Transform {
+    constructor(handle, options) {
+        super(options);
+        this._handle = handle;
+        this._busy = false;
+    }
+
+    /**
+     * Flush buffered input so everything written so far can be decoded
+     * @param {Function} [callback] - Called once the flush has been processed
+     */
+    flush(callback) {
+        this.write(kFlushMarker, callback);
+    }
+
+    _process(chunk, mode, callback) {
+        const step = (offset) => {
+            this._busy = true;
+            this._handle.transform(chunk, offset, mode, (error, output, consumed, done) => {
+                this._busy = false;
+                if (this.destroyed) {
+                    this._handle.close();
+                    return callback();
+                }
+                if (error) {
+                    return callback(error);
+                }
+                if (output.length > 0) {
+                    this.push(output);
+                }
+                if (done) {
+                    return callback();
+                }
+                step(consumed);
+            });
+        };
+
+        try {
+            step(0);
+        } catch (error) {
+            this._busy = false;
+            callback(error);
+        }
+    }
+
+    _transform(chunk, encoding, callback) {
+        if (chunk === kFlushMarker) {
+            return this._process(kEmpty, addon.FLUSH_FLUSH, callback);
+        }
+        if (!Buffer.isBuffer(chunk)) {
+            chunk = Buffer.from(chunk, encoding);
+        }
+        this._process(chunk, addon.FLUSH_CONTINUE, callback);
+    }
+
+    _flush(callback) {
+        this._process(kEmpty, addon.FLUSH_END, (error) => {
+            this._handle.close();
+            callback(error);
+        });
+    }
+
+    _destroy(error, callback) {
+        // An in-flight step closes the handle when it completes
+        if (!this._busy) {
+            this._handle.close();
         }
+        callback(error);
+    }
+}
+
+/**
+ * Transform stream compressing its input with ZSTD_compressStream2
+ * @param {Object} [options] - Transform options plus the zstdCompress options and chunkSize
+ * @param {number} [options.chunkSize] - Output window size (default ZSTD_CStreamOutSize)
+ */
+class ZstdCompress extends ZstdTransform {
+    constructor(options = {}) {
+        super(new addon.CompressStream(options, options.chunkSize), options);
+    }
+}
+
+/**
+ * Transform stream decompressing its input with ZSTD_decompressStream
+ * Accepts frames of unknown content size and concatenated frames.
+ * @param {Object} [options] - Transform options plus dictionary, ignoreChecksum and chunkSize
+ * @param {Dictionary} [options.dictionary] - Dictionary the data was compressed with
+ * @param {boolean} [options.ignoreChecksum=false] - Skip checksumFlag verification, see zstdDecompress
+ * @param {number} [options.chunkSize] - Output window size (default ZSTD_DStreamOutSize)
+ */
+class ZstdDecompress extends ZstdTransform {
+    constructor(options = {}) {
+        const { dictionary, ignoreChecksum } = options;
+        super(new addon.DecompressStream({ dictionary, ignoreChecksum }, options.chunkSize), options);
+    }
+}
+
+/**
+ * Create a compressing Transform stream
+ * @param {Object} [options] - See ZstdCompress
+ * @returns {ZstdCompress}
+ */
+function createZstdCompress(options) {
+    return new ZstdCompress(options);
+}
+
+/**
+ * Create a decompressing Transform stream
+ * @param {Object} [options] - See ZstdDecompress
+ * @returns {ZstdDecompress}
+ */
+function createZstdDecompress(options) {
+    return new ZstdDecompress(options);
+}
+
+// One native step: resolves to [output, consumed, done]
+function transformStep(handle, chunk, offset, mode) {
+    return new Promise((resolve, reject) => {
+        handle.transform(chunk, offset, mode, (error, output, consumed, done) => {
+            if (error) {
+                return reject(error);
+            }
+            resolve([output, consumed, done]);
+        });
     });
 }
 
+// Yields the output windows for one chunk; each step runs only once the
+// previous window has been taken
+async function* drainChunk(handle, chunk, mode) {
+    let offset = 0;
+    for (;;) {
+        const [output, consumed, done] = await transformStep(handle, chunk, offset, mode);
+        if (output.length > 0) {
+            yield output;
+        }
+        if (done) {
+            return;
+        }
+        offset = consumed;
+    }
+}
+
+async function* transformChunks(handle, source) {
+    try {
+        for await (let chunk of source) {
+            if (typeof chunk === 'string') {
+                chunk = Buffer.from(chunk);
+            }
+            yield* drainChunk(handle, chunk, addon.FLUSH_CONTINUE);
+        }
+        yield* drainChunk(handle, kEmpty, addon.FLUSH_END);
+    } finally {
+        // No step is in flight here: return() waits for a pending next()
+        handle.close();
+    }
+}
+
+/**
+ * Compress the chunks of an iterable or async iterable
+ * Output windows are produced one step at a time as the generator is
+ * consumed, so nothing is buffered beyond one window.
+ * @param {Iterable<BytesLike|string>|AsyncIterable<BytesLike|string>} source - Chunks to compress
+ * @param {Object} [options] - zstdCompress options plus chunkSize, see ZstdCompress
+ * @returns {AsyncGenerator<Buffer>} The compressed stream in chunks
+ */
+function compressChunks(source, options = {}) {
+    return transformChunks(new addon.CompressStream(options, options.chunkSize), source);
+}
+
+/**
+ * Decompress the chunks of an iterable or async iterable, see compressChunks
+ * @param {Iterable<BytesLike>|AsyncIterable<BytesLike>} source - Compressed chunks
+ * @param {Object} [options] - dictionary, ignoreChecksum and chunkSize, see ZstdDecompress
+ * @returns {AsyncGenerator<Buffer>} The decompressed stream in chunks
+ */
+function decompressChunks(source, options = {}) {
+    const { dictionary, ignoreChecksum } = options;
+    return transformChunks(new addon.DecompressStream({ dictionary, ignoreChecksum }, options.chunkSize), source);
+}
+
 /**
- * Set maximum allowed input size
+ * WHATWG transform stream ({ readable, writable }) over a native streaming
+ * handle, usable with pipeThrough() like CompressionStream
+ * Output is produced only as the readable side is read: a write settles
+ * once its chunk has been fully drained, so an unread stream holds at most
+ * one chunk and one output window.
+ */
+class ZstdWebTransform {
+    constructor(handle) {
+        const { ReadableStream, WritableStream } = require('stream/web');
+        let input = null;   // chunk being drained: { windows, last, resolve, reject }
+        let wake = null;    // resolves a pull waiting for input
+        let stepping = false;
+        let closed = false;
+        let failure = null;
+        let readableController;
+
+        const abort = (reason) => {
+            fail(reason);
+            readableController.error(reason);
+        };
+        const release = () => {
+            if (!closed && !stepping) {
+                closed = true;
+                handle.close();
+            }
+        };
+        const fail = (reason) => {
+            failure = failure || reason;
+            if (input) {
+                input.reject(reason);
+                input = null;
+            }
+            release();
+        };
+        const feed = (chunk, mode) => new Promise((resolve, reject) => {
+            if (failure) {
+                return reject(failure);
+            }
+            input = { windows: drainChunk(handle, chunk, mode), last: mode === addon.FLUSH_END, resolve, reject };
+            if (wake) {
+                wake();
+                wake = null;
+            }
+        });
+
+        this.readable = new ReadableStream({
+            start(controller) {
+                readableController = controller;
+            },
+            async pull(controller) {
+                for (;;) {
+                    while (!input) {
+                        await new Promise(resolve => { wake = resolve; });
+                    }
+                    const current = input;
+                    let result;
+                    stepping = true;
+                    try {
+                        result = await current.windows.next();
+                    } catch (error) {
+                        stepping = false;
+                        fail(error);
+                        throw error;
+                    }
+                    stepping = false;
+                    if (failure) {
+                        // Aborted or cancelled while the step ran
+                        return release();
+                    }
+                    if (!result.done) {
+                        return controller.enqueue(result.value);
+                    }
+                    input = null;
+                    current.resolve();
+                    if (current.last) {
+                        release();
+                        return controller.close();
+                    }
+                }
+            },
+            cancel(reason) {
+                fail(reason);
+            }
+        }, { highWaterMark: 0 });
+
+        this.writable = new WritableStream({
+            start(controller) {
+                // abort() is held back until the write in flight settles,
+                // which here waits for a reader; the signal fires at once
+                if (controller.signal) {
+                    controller.signal.addEventListener('abort', () => abort(controller.signal.reason));
+                }
+            },
+            write(chunk) {
+                return feed(chunk, addon.FLUSH_CONTINUE);
+            },
+            close() {
+                return feed(kEmpty, addon.FLUSH_END);
+            },
+            abort
+        });
+    }
+}
+
+/**
+ * CompressionStream-compatible zstd compressor for Web Streams
+ * @example response.body.pipeThrough(new ZstdCompressionStream({ level: 3 }))
+ * @param {Object} [options] - zstdCompress options plus chunkSize, see ZstdCompress
+ */
+class ZstdCompressionStream extends ZstdWebTransform {
+    constructor(options = {}) {
+        super(new addon.CompressStream(options, options.chunkSize));
+    }
+}
+
+/**
+ * DecompressionStream-compatible zstd decompressor for Web Streams
+ * @param {Object} [options] - dictionary, ignoreChecksum and chunkSize, see ZstdDecompress
+ */
+class ZstdDecompressionStream extends ZstdWebTransform {
+    constructor(options = {}) {
+        const { dictionary, ignoreChecksum } = options;
+        super(new addon.DecompressStream({ dictionary, ignoreChecksum }, options.chunkSize));
+    }
+}
+
+/**
+ * Set maximum allowed input size for the calling thread
+ * Each worker_thread has its own limits.
  * @param {number} size - Maximum size in bytes
  * @throws {Error} If size is not a number
  */
@@ -51,7 +659,7 @@ function setMaxInputSize(size) {
 }
 
 /**
- * Set maximum allowed output size
+ * Set maximum allowed output size for the calling thread
  * @param {number} size - Maximum size in bytes
  * @throws {Error} If size is not a number
  */
@@ -59,13 +667,156 @@ function setMaxOutputSize(size) {
     addon.setMaxOutputSize(size);
 }
 
+/**
+ * Get the size limits of the calling thread
+ * @returns {{maxInputSize: number, maxOutputSize: number}}
+ */
+function getLimits() {
+    return addon.getLimits();
+}
+
+/**
+ * Describe every frame of compressed data from the frame headers alone,
+ * without decompressing or allocating output
+ * @param {BytesLike} buffer - Compressed data (one or more frames)
+ * @returns {{frames: Object[], compressedSize: number, contentSize: number|null}}
+ *   Per-frame metadata; contentSize is null if any frame omits its size
+ * @throws {Error} If the data is not a sequence of complete frames
+ */
+function getFrameInfo(buffer) {
+    return addon.getFrameInfo(buffer);
+}
+
+/**
+ * Get process-wide counters from the native layer: calls, bytes and time
+ * spent inside libzstd per direction, context-pool hits/misses, queued
+ * asynchronous jobs and the largest output block allocated.
+ * Counters only grow; sample them and export the deltas.
+ * @returns {Object} Snapshot of the counters
+ */
+function getStats() {
+    return addon.getStats();
+}
+
+/**
+ * Cap the native memory used by contexts, dictionaries and output buffers
+ * not yet handed to JS, across the whole process. Work that would pass the
+ * budget fails with an error instead of allocating.
+ * @param {number} bytes - Budget in bytes, or 0 for no budget (the default)
+ */
+function setMemoryBudget(bytes) {
+    addon.setMemoryBudget(bytes);
+}
+
+/**
+ * Get the native memory currently charged to the budget
+ * @returns {{budget: number, total: number, contexts: number, dictionaries: number,
+ *   buffers: number, peak: number, rejected: number}} Bytes in use per kind,
+ *   the highest total seen, and how many allocations were refused
+ */
+function getMemoryUsage() {
+    return addon.getMemoryUsage();
+}
+
+/**
+ * Estimate context memory for compression options without allocating it,
+ * using ZSTD_estimateCCtxSize_usingCCtxParams and friends
+ * @param {number|Object} [options=3] - Compression level or options, see zstdCompress
+ * @param {number} [size] - Input size; default: unknown, which sizes for the worst case
+ * @returns {{compress: number, compressStream: number, decompress: number,
+ *   decompressStream: number}} Bytes for one-shot and streaming contexts
+ */
+function estimateMemory(options, size) {
+    return addon.estimateMemory(options, size);
+}
+
+/**
+ * Place every thread's pooled contexts in one arena, sized up front with
+ * ZSTD_estimateCStreamSize_usingCCtxParams / ZSTD_estimateDStreamSize and
+ * initialized with ZSTD_initStaticCCtx / ZSTD_initStaticDCtx, so libzstd
+ * never allocates for them. Can be called once per process; each thread
+ * switches to its slot on its next call.
+ * @param {number|Object} [options=3] - Highest level (and advanced parameters) the pool must serve
+ * @param {number} [options.maxInputSize] - Largest input, which shrinks the slots; default: unknown
+ * @param {number} [options.slots] - Threads to reserve for; default: UV_THREADPOOL_SIZE + 1
+ * @returns {{slots: number, compressSlotSize: number, decompressSlotSize: number, bytes: number}}
+ * @throws {Error} If an arena is already configured or workers are requested
+ */
+function configureContextArena(options) {
+    return addon.configureContextArena(options);
+}
+
+/**
+ * Recycle output blocks instead of allocating one per call. Blocks are
+ * returned when their Buffer is collected (or at once when the output is
+ * copied), and idle ones are kept up to maxIdleBytes.
+ * @param {Object} [options] - Omit to turn the pool off and free idle blocks
+ * @param {number} [options.maxIdleBytes=0] - Idle blocks to keep; 0 turns the pool off
+ * @param {number} [options.maxBlockSize=4194304] - Largest block size that is pooled
+ */
+function configureBufferPool(options) {
+    addon.configureBufferPool(options);
+}
+
+/**
+ * Run the asynchronous calls on native threads of the addon's own instead of
+ * the libuv threadpool. Jobs of up to latencyJobSize input bytes are queued
+ * ahead of larger ones, and the first latencyThreads threads run only those;
+ * idle threads steal queued jobs from busy ones. The pool is process-wide.
+ * @param {Object} [options] - Omit for one thread per CPU
+ * @param {number} [options.threads] - Pool size, default: one per CPU; 0 returns to the libuv threadpool
+ * @param {number} [options.latencyThreads] - Threads reserved for small jobs; default 1 with two or more threads
+ * @param {number} [options.latencyJobSize=65536] - Largest input, in bytes, queued as a small job
+ * @param {number[]} [options.affinity] - CPUs to pin to, thread i on affinity[i % length] (Linux only)
+ * @returns {{threads: number, latencyThreads: number, latencyJobSize: number}}
+ * @throws {Error} If jobs are queued or running, or the options are invalid
+ */
+function configureThreadPool(options) {
+    return addon.configureThreadPool(options);
+}
+
 module.exports = {
     zstdCompress,
     zstdDecompress,
+    zstdCompressSync,
+    zstdDecompressSync,
+    compressInto,
+    decompressInto,
+    compressBatch,
+    decompressBatch,
+    compressFile,
+    decompressFile,
+    compressDelta,
+    decompressDelta,
+    compressSeekable,
+    readRange,
+    readRangeSync,
+    compressBound: addon.compressBound,
+    Dictionary: addon.Dictionary,
+    trainDictionary,
+    Compressor,
+    Decompressor,
+    ZstdCompress,
+    ZstdDecompress,
+    createZstdCompress,
+    createZstdDecompress,
+    compressChunks,
+    decompressChunks,
+    ZstdCompressionStream,
+    ZstdDecompressionStream,
     setMaxInputSize,
     setMaxOutputSize,
-    getLimits: addon.getLimits,
+    getLimits,
+    getStats,
+    getFrameInfo,
+    setMemoryBudget,
+    getMemoryUsage,
+    estimateMemory,
+    configureContextArena,
+    configureBufferPool,
+    configureThreadPool,
     MIN_LEVEL: addon.MIN_LEVEL,
     MAX_LEVEL: addon.MAX_LEVEL,
-    DEFAULT_LEVEL: addon.DEFAULT_LEVEL
+    DEFAULT_LEVEL: addon.DEFAULT_LEVEL,
+    MAX_WORKERS: addon.MAX_WORKERS
 };
\ No newline at end of file
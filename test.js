@@ -1,15 +1,55 @@
 const {
     zstdCompress: compress,
     zstdDecompress: decompress,
+    zstdCompressSync: compressSync,
+    zstdDecompressSync: decompressSync,
+    compressInto,
+    decompressInto,
+    compressBatch,
+    decompressBatch,
+    compressFile,
+    decompressFile,
+    compressDelta,
+    decompressDelta,
+    compressSeekable,
+    readRange,
+    readRangeSync,
+    compressBound,
+    Compressor,
+    Decompressor,
+    createZstdCompress,
+    createZstdDecompress,
+    compressChunks,
+    decompressChunks,
+    ZstdCompressionStream,
+    ZstdDecompressionStream,
+    Dictionary,
+    trainDictionary,
     setMaxInputSize,
     setMaxOutputSize,
     getLimits,
+    getStats,
+    getFrameInfo,
+    setMemoryBudget,
+    getMemoryUsage,
+    estimateMemory,
+    configureContextArena,
+    configureBufferPool,
+    configureThreadPool,
     MIN_LEVEL,
     MAX_LEVEL,
-    DEFAULT_LEVEL
+    DEFAULT_LEVEL,
+    MAX_WORKERS,
 } = require('./index.js');
 
 const assert = require('assert');
+const crypto = require('crypto');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { Readable, Writable } = require('stream');
+const { pipeline } = require('stream/promises');
+const { Worker } = require('worker_threads');
 const DEFAULT_MAX_OUTPUT_SIZE = 2 * 1024 * 1024 * 1024; // 2GB
 
 // Helper function for synchronous testing
@@ -141,8 +181,1274 @@ const test8 = async () => {
     assert.strictEqual(typeof MIN_LEVEL, 'number');
     assert.strictEqual(typeof MAX_LEVEL, 'number');
     assert.strictEqual(typeof DEFAULT_LEVEL, 'number');
-    assert(MIN_LEVEL >= 1);
-    assert(MAX_LEVEL <= 22);
+    // The range comes from ZSTD_minCLevel()/ZSTD_maxCLevel(), negative levels included
+    assert(MIN_LEVEL < 0);
+    assert(MAX_LEVEL >= 19);
+};
+
+// Test 9: Synchronous variants
+const test9 = async () => {
+    const input = Buffer.from('Hello, sync zstd!');
+    const compressed = compressSync(input, 5);
+    assert(Buffer.isBuffer(compressed));
+    assert.strictEqual(decompressSync(compressed).toString(), 'Hello, sync zstd!');
+
+    // Sync and async output must be interchangeable
+    assert.strictEqual((await decompress(compressed)).toString(), 'Hello, sync zstd!');
+    assert.strictEqual(decompressSync(await compress(input)).toString(), 'Hello, sync zstd!');
+
+    assert.throws(() => compressSync('not a buffer'), /must be a Buffer/);
+    assert.throws(() => decompressSync(Buffer.from([1, 2, 3])), /Invalid compressed data/);
+};
+
+// Test 10: Async work does not block the event loop
+const test10 = async () => {
+    const input = Buffer.alloc(8 * 1024 * 1024);
+    for (let i = 0; i < input.length; i++) input[i] = (i * 31) & 0xff;
+
+    let ticks = 0;
+    const timer = setInterval(() => ticks++, 0);
+    const pending = compress(input, 19);
+    assert(pending instanceof Promise);
+    await new Promise(resolve => setTimeout(resolve, 5));
+    const compressed = await pending;
+    clearInterval(timer);
+
+    assert(ticks > 0);
+    const results = await Promise.all([decompress(compressed), decompress(compressed)]);
+    results.forEach(out => assert(out.equals(input)));
+};
+
+// Test 11: Reusable Compressor/Decompressor contexts
+const test11 = async () => {
+    const compressor = new Compressor(7);
+    const decompressor = new Decompressor();
+    assert.strictEqual(compressor.level, 7);
+
+    for (let i = 0; i < 20; i++) {
+        const input = Buffer.from(`message ${i} `.repeat(i + 1));
+        const compressed = i % 2 ? compressor.compressSync(input) : await compressor.compress(input);
+        const decompressed = i % 2 ? await decompressor.decompress(compressed) : decompressor.decompressSync(compressed);
+        assert(decompressed.equals(input));
+    }
+
+    // Only one operation may use the context at a time
+    const first = compressor.compress(Buffer.alloc(1024 * 1024));
+    await assert.rejects(compressor.compress(Buffer.from('x')), /busy/);
+    assert.throws(() => compressor.compressSync(Buffer.from('x')), /busy/);
+    await first;
+    assert(compressor.compressSync(Buffer.from('x')).length > 0);
+
+    assert.throws(() => new Compressor(MAX_LEVEL + 1), /between/);
+};
+
+// Test 12: Output buffers are handed over without padding or sharing
+const test12 = async () => {
+    const input = Buffer.from('B'.repeat(4 * 1024 * 1024));
+    const compressed = await compress(input);
+    assert(compressed.length < input.length / 100);
+    assert.strictEqual(compressed.buffer.byteLength, compressed.length);
+
+    const first = await decompress(compressed);
+    const second = decompressSync(compressed);
+    assert(first.equals(input) && second.equals(input));
+    first[0] = 0;
+    assert.strictEqual(second[0], 'B'.charCodeAt(0));
+};
+
+// Test 13: Compress/decompress into caller-supplied memory
+const test13 = async () => {
+    const input = Buffer.from('slab allocated payload '.repeat(100));
+    const slab = Buffer.alloc(compressBound(input.length) + 64);
+    const written = compressInto(input, slab, 64, 5);
+    assert(written > 0 && written < input.length);
+    assert(slab.subarray(0, 64).every(b => b === 0));
+
+    const compressed = slab.subarray(64, 64 + written);
+    assert.strictEqual(decompressSync(Buffer.from(compressed)).toString(), input.toString());
+
+    const target = new Uint8Array(input.length + 16);
+    assert.strictEqual(decompressInto(compressed, target, 16), input.length);
+    assert(Buffer.from(target.buffer, 16, input.length).equals(input));
+
+    assert.strictEqual(compressInto(Buffer.alloc(0), slab), 0);
+    assert.throws(() => decompressInto(compressed, Buffer.alloc(10)), /too small/);
+    assert.throws(() => compressInto(input, slab, slab.length + 1), /outside/);
+    assert.throws(() => compressInto(input, 'nope'), /Destination/);
+
+    // Stored input round-trips through caller memory, also when only the
+    // stored form fits the destination
+    const noise = crypto.randomBytes(300);
+    const stored = Buffer.alloc(noise.length + 1);
+    assert.strictEqual(compressInto(noise, stored, 0, { rawFallback: true }), noise.length + 1);
+    assert.strictEqual(stored[0], 0);
+    assert(stored.equals(compressSync(noise, { rawFallback: true })));
+    const roomy = Buffer.alloc(compressBound(noise.length));
+    assert.strictEqual(compressInto(noise, roomy, 0, { rawFallback: true }), noise.length + 1);
+    const unpacked = Buffer.alloc(noise.length);
+    assert.strictEqual(decompressInto(stored, unpacked, 0, { rawFallback: true }), noise.length);
+    assert(unpacked.equals(noise));
+    assert.throws(() => decompressInto(stored, Buffer.alloc(10), 0, { rawFallback: true }), /too small/);
+    assert.throws(() => decompressInto(stored, unpacked), /Decompression failed/);
+};
+
+// Collects a stream pipeline's output into one Buffer
+async function pipeThrough(chunks, ...transforms) {
+    const out = [];
+    await pipeline(
+        Readable.from(chunks),
+        ...transforms,
+        new Writable({
+            write(chunk, encoding, callback) {
+                out.push(chunk);
+                callback();
+            }
+        })
+    );
+    return Buffer.concat(out);
+}
+
+// Test 14: Streaming Transform round trip
+const test14 = async () => {
+    const chunks = [];
+    for (let i = 0; i < 200; i++) {
+        chunks.push(Buffer.from(`line ${i}: ${'x'.repeat(i % 50)}\n`.repeat(100)));
+    }
+    const input = Buffer.concat(chunks);
+
+    const compressed = await pipeThrough(chunks, createZstdCompress({ level: 5 }));
+    assert(compressed.length < input.length);
+
+    // Small output windows force many native steps per chunk
+    const decompressed = await pipeThrough([compressed], createZstdDecompress({ chunkSize: 1024 }));
+    assert(decompressed.equals(input));
+
+    // Concatenated frames decode as one stream
+    const twice = await pipeThrough([Buffer.concat([compressed, compressed])], createZstdDecompress());
+    assert(twice.equals(Buffer.concat([input, input])));
+
+    // Empty streams stay empty
+    assert.strictEqual((await pipeThrough([], createZstdCompress(), createZstdDecompress())).length, 0);
+
+    // Truncated input is reported at the end of the stream
+    await assert.rejects(
+        pipeThrough([compressed.subarray(0, compressed.length - 4)], createZstdDecompress()),
+        /Truncated/
+    );
+};
+
+// Test 15: Stream flush makes written data decodable
+const test15 = async () => {
+    const compressor = createZstdCompress();
+    const decompressor = createZstdDecompress();
+    const received = [];
+    compressor.pipe(decompressor).on('data', chunk => received.push(chunk));
+
+    compressor.write(Buffer.from('first message'));
+    await new Promise(resolve => compressor.flush(resolve));
+    for (let i = 0; i < 100 && Buffer.concat(received).length < 13; i++) {
+        await new Promise(resolve => setTimeout(resolve, 10));
+    }
+    assert.strictEqual(Buffer.concat(received).toString(), 'first message');
+
+    compressor.end(Buffer.from(', second'));
+    await new Promise(resolve => decompressor.on('end', resolve));
+    assert.strictEqual(Buffer.concat(received).toString(), 'first message, second');
+};
+
+// Test 16: Dictionary compression
+const test16 = async () => {
+    // A raw-content dictionary built from representative samples
+    const sample = (i) => Buffer.from(JSON.stringify({
+        type: 'page_view', user: `user-${i}`, path: '/products/list', agent: 'Mozilla/5.0 (X11; Linux x86_64)'
+    }));
+    const dictionary = new Dictionary(Buffer.concat([sample(1), sample(2), sample(3)]), 9);
+    assert.strictEqual(dictionary.level, 9);
+    assert(dictionary.size > 0);
+
+    const input = sample(42);
+    const plain = await compress(input);
+    const packed = await compress(input, { dictionary });
+    assert(packed.length < plain.length);
+    assert((await decompress(packed, { dictionary })).equals(input));
+    assert(decompressSync(compressSync(input, { dictionary, level: 1 }), { dictionary }).equals(input));
+
+    // Concurrent jobs share the digested dictionary
+    const all = await Promise.all(Array.from({ length: 16 }, (_, i) => compress(sample(i), { dictionary, level: i + 1 })));
+    for (let i = 0; i < all.length; i++) {
+        assert((await decompress(all[i], { dictionary })).equals(sample(i)));
+    }
+
+    const compressor = new Compressor({ dictionary });
+    const decompressor = new Decompressor({ dictionary });
+    assert.strictEqual(compressor.level, 9);
+    assert(decompressor.decompressSync(compressor.compressSync(input)).equals(input));
+
+    const streamed = await pipeThrough([input, input], createZstdCompress({ dictionary }), createZstdDecompress({ dictionary }));
+    assert(streamed.equals(Buffer.concat([input, input])));
+
+    assert.throws(() => compressSync(input, { dictionary: {} }), /must be a Dictionary/);
+    assert.throws(() => compressSync(input, { dictionary: compressor }), /must be a Dictionary/);
+    assert.throws(() => new Dictionary(Buffer.alloc(0)), /empty/);
+};
+
+// Test 17: Dictionary training
+const test17 = async () => {
+    const samples = [];
+    for (let i = 0; i < 2000; i++) {
+        samples.push(Buffer.from(JSON.stringify({
+            id: i, kind: ['click', 'view', 'scroll'][i % 3], session: `s-${i % 97}`, ts: 1700000000 + i * 13
+        })));
+    }
+
+    const trained = await trainDictionary(samples, 4096);
+    assert(trained.length > 0 && trained.length <= 4096);
+    const dictionary = new Dictionary(trained);
+    assert(dictionary.id !== 0);
+
+    const tuned = await trainDictionary(samples, 4096, { d: 8, steps: 4, level: 5, dictID: 1234 });
+    assert.strictEqual(new Dictionary(tuned).id, 1234);
+    // level and dictID on their own train with fastCover rather than being dropped
+    const numbered = await trainDictionary(samples, 4096, { level: 19, dictID: 42 });
+    assert.strictEqual(new Dictionary(numbered).id, 42);
+    assert.strictEqual(numbered.readUInt32LE(4), 42);
+    assert.strictEqual(new Dictionary(await trainDictionary(samples, 4096, { dictID: 7 })).id, 7);
+
+    const packed = compressSync(samples[7], { dictionary });
+    assert(packed.length < compressSync(samples[7]).length);
+    assert(decompressSync(packed, { dictionary }).equals(samples[7]));
+
+    await assert.rejects(trainDictionary([], 4096), /At least one sample/);
+    await assert.rejects(trainDictionary(['x'], 4096), /must be a Buffer/);
+    await assert.rejects(trainDictionary(samples, 10), /capacity/);
+};
+
+// Test 18: Multithreaded compression
+const test18 = async () => {
+    assert.strictEqual(typeof MAX_WORKERS, 'number');
+    const input = Buffer.alloc(20 * 1024 * 1024);
+    for (let i = 0; i < input.length; i++) input[i] = (i % 251) ^ (i >> 12);
+
+    // Falls back to single-threaded output when multithreading is unavailable
+    for (const options of [{ workers: 4 }, { workers: 'auto' }, { workers: 2, jobSize: 1 << 20, overlapLog: 6 }]) {
+        const compressed = await compress(input, options);
+        assert((await decompress(compressed)).equals(input));
+    }
+    assert(decompressSync(compressSync(Buffer.from('tiny'), { workers: 'auto' })).equals(Buffer.from('tiny')));
+
+    const streamed = await pipeThrough([input], createZstdCompress({ workers: 2 }), createZstdDecompress());
+    assert(streamed.equals(input));
+
+    assert.throws(() => compressSync(input, { workers: -1 }), /workers/);
+    assert.throws(() => compressSync(input, { workers: 'many' }), /workers/);
+};
+
+// Test 19: Advanced parameters and negative levels
+const test19 = async () => {
+    const input = Buffer.from('advanced parameters '.repeat(5000));
+    const fast = await compress(input, { level: -5 });
+    assert((await decompress(fast)).equals(input));
+    assert(decompressSync(compressSync(input, MIN_LEVEL)).equals(input));
+
+    const tuned = await compress(input, {
+        level: 19, windowLog: 20, strategy: 'btultra2', enableLongDistanceMatching: true,
+        checksumFlag: true, targetCBlockSize: 4096
+    });
+    assert((await decompress(tuned)).equals(input));
+
+    // A frame without content size can still be described by the flag
+    const withChecksum = compressSync(input, { checksumFlag: true });
+    const withoutChecksum = compressSync(input, { checksumFlag: false });
+    assert.strictEqual(withChecksum.length, withoutChecksum.length + 4);
+
+    // Repeated calls with the same options reuse the configured context
+    const again = await Promise.all([1, 2, 3].map(() => compress(input, { level: 7, windowLog: 18 })));
+    again.forEach(out => assert(out.equals(again[0])));
+
+    const compressor = new Compressor({ level: -1, strategy: 1 });
+    assert(decompressSync(compressor.compressSync(input)).equals(input));
+    const streamed = await pipeThrough([input], createZstdCompress({ level: -3, checksumFlag: true }), createZstdDecompress());
+    assert(streamed.equals(input));
+
+    assert.throws(() => compressSync(input, { windowLog: 99 }), /windowLog must be between/);
+    assert.throws(() => compressSync(input, { strategy: 'fastest' }), /Unknown strategy/);
+    assert.throws(() => compressSync(input, { hashLog: 'big' }), /hashLog must be a number/);
+    assert.throws(() => compressSync(input, MIN_LEVEL - 1), /between/);
+};
+
+// Test 20: Batch API
+const test20 = async () => {
+    const records = [];
+    for (let i = 0; i < 500; i++) {
+        records.push(Buffer.from(`{"id":${i},"name":"record ${i}","payload":"${'x'.repeat(i % 97)}"}`));
+    }
+    records.push(Buffer.alloc(0));
+    records.push(Buffer.from('big '.repeat(100000)));
+
+    const packed = await compressBatch(records, 5);
+    assert.strictEqual(packed.length, records.length);
+    packed.forEach((item, i) => assert(decompressSync(item).equals(records[i])));
+
+    const unpacked = await decompressBatch(packed);
+    unpacked.forEach((item, i) => assert(item.equals(records[i])));
+
+    const { buffer, offsets } = await decompressBatch(packed, { contiguous: true });
+    assert.strictEqual(offsets.length, records.length + 1);
+    assert.strictEqual(offsets[records.length], buffer.length);
+    records.forEach((record, i) => assert(buffer.subarray(offsets[i], offsets[i + 1]).equals(record)));
+
+    // Dictionaries and the contiguous layout combine
+    const dictionary = new Dictionary(Buffer.concat(records.slice(0, 50)));
+    const joined = await compressBatch(records, { dictionary, contiguous: true });
+    const items = records.map((_, i) => joined.buffer.subarray(joined.offsets[i], joined.offsets[i + 1]));
+    const back = await decompressBatch(items, { dictionary });
+    back.forEach((item, i) => assert(item.equals(records[i])));
+
+    assert.deepStrictEqual(await compressBatch([]), []);
+    assert.deepStrictEqual((await compressBatch([], { contiguous: true })).offsets, [0]);
+
+    const corrupt = packed.slice(0, 3).concat([Buffer.from('not zstd data')]);
+    await assert.rejects(decompressBatch(corrupt), /Item 3:/);
+    await assert.rejects(compressBatch('nope'), /array of Buffers/);
+    await assert.rejects(compressBatch([Buffer.alloc(1), 'x']), /Item 1 must be a Buffer/);
+    await assert.rejects(compressBatch(records, { contiguous: 'yes' }), /contiguous/);
+};
+
+// Test 21: Per-instance limits
+const test21 = async () => {
+    const input = Buffer.from('tenant data '.repeat(1000));
+    const small = new Compressor({ level: 1, maxInputSize: 1024 });
+    assert.throws(() => small.compressSync(input), /exceeds maximum allowed size 1024/);
+    await assert.rejects(small.compress(input), /exceeds/);
+    assert(small.compressSync(input.subarray(0, 1024)).length > 0);
+
+    // Other instances and the plain functions keep the process-wide limits
+    const compressed = await new Compressor({ level: 1 }).compress(input);
+    assert(decompressSync(compressed).equals(input));
+
+    const capped = new Decompressor({ maxOutputSize: 100 });
+    assert.throws(() => capped.decompressSync(compressed), /Output size/);
+    assert(new Decompressor({ maxOutputSize: input.length }).decompressSync(compressed).equals(input));
+
+    // An instance cap replaces the global one rather than being clamped by it
+    try {
+        setMaxInputSize(10);
+        assert(new Compressor({ maxInputSize: input.length }).compressSync(input).length > 0);
+        assert.throws(() => new Compressor().compressSync(input), /exceeds/);
+    } finally {
+        setMaxInputSize(DEFAULT_MAX_OUTPUT_SIZE);
+    }
+
+    assert.throws(() => new Compressor({ maxInputSize: -1 }), /cannot be negative/);
+    assert.throws(() => new Decompressor({ maxOutputSize: '1' }), /must be a number/);
+};
+
+// Test 22: Unknown content size and multiple frames
+const test22 = async () => {
+    const input = Buffer.from('frame without size '.repeat(20000));
+    const sizeless = compressSync(input, { contentSizeFlag: false });
+    assert(decompressSync(sizeless).equals(input));
+    assert((await decompress(sizeless)).equals(input));
+
+    // Stream output never declares its size
+    const streamed = await pipeThrough([input], createZstdCompress());
+    assert((await decompress(streamed)).equals(input));
+
+    // Concatenated frames, with and without sizes, decode back to back
+    const first = compressSync(Buffer.from('first;'));
+    const mixed = Buffer.concat([first, sizeless, first]);
+    const expected = Buffer.concat([Buffer.from('first;'), input, Buffer.from('first;')]);
+    assert(decompressSync(mixed).equals(expected));
+    assert(decompressSync(Buffer.concat([first, first])).toString() === 'first;first;');
+
+    // Skippable frames are ignored
+    const skippable = Buffer.alloc(12);
+    skippable.writeUInt32LE(0x184D2A50, 0);
+    skippable.writeUInt32LE(4, 4);
+    assert(decompressSync(Buffer.concat([skippable, first])).toString() === 'first;');
+
+    const dictionary = new Dictionary(Buffer.from('frame without size '.repeat(10)));
+    const withDictionary = compressSync(input, { dictionary, contentSizeFlag: false });
+    assert(decompressSync(withDictionary, { dictionary }).equals(input));
+    // The pooled context does not keep the dictionary for later calls
+    assert(decompressSync(sizeless).equals(input));
+    assert(new Decompressor({ dictionary }).decompressSync(withDictionary).equals(input));
+
+    // Growth stops at the output limit
+    try {
+        setMaxOutputSize(input.length - 1);
+        assert.throws(() => decompressSync(sizeless), /Output size/);
+        setMaxOutputSize(input.length);
+        assert(decompressSync(sizeless).equals(input));
+    } finally {
+        setMaxOutputSize(DEFAULT_MAX_OUTPUT_SIZE);
+    }
+
+    assert.throws(() => decompressSync(sizeless.subarray(0, sizeless.length - 3)), /Invalid compressed data/);
+    assert.throws(() => decompressSync(Buffer.concat([first, Buffer.from('junk')])), /Invalid compressed data/);
+};
+
+// Test 23: Seekable format
+const test23 = async () => {
+    const input = Buffer.alloc(300000);
+    for (let i = 0; i < input.length; i++) {
+        input[i] = (i * 7 + (i >> 10)) & 0xff;
+    }
+    const seekable = await compressSeekable(input, { level: 5, frameSize: 65536 });
+
+    // Plain zstd data with a trailing seek table
+    assert(decompressSync(seekable).equals(input));
+    assert.strictEqual(seekable.readUInt32LE(seekable.length - 4), 0x8F92EAB1);
+    assert.strictEqual(seekable.readUInt32LE(seekable.length - 9), 5);
+
+    for (const [offset, length] of [[0, 10], [65530, 20], [65536, 65536], [1000, 200000], [299990, 10]]) {
+        const expected = input.subarray(offset, offset + length);
+        assert((await readRange(seekable, offset, length)).equals(expected));
+        assert(readRangeSync(seekable, offset, length).equals(expected));
+    }
+    assert(readRangeSync(seekable, 299990, 1000).equals(input.subarray(299990)));
+    assert(readRangeSync(seekable, 100).equals(input.subarray(100)));
+    assert.strictEqual(readRangeSync(seekable, input.length, 10).length, 0);
+
+    // Checksums are copied into the table, whose entries grow to 12 bytes
+    const checked = await compressSeekable(input, { frameSize: 100000, checksumFlag: true });
+    assert.strictEqual(checked[checked.length - 5], 0x80);
+    assert(readRangeSync(checked, 150000, 100000).equals(input.subarray(150000, 250000)));
+
+    const dictionary = new Dictionary(input.subarray(0, 4096));
+    const withDictionary = await compressSeekable(input, { dictionary, frameSize: 50000 });
+    assert((await readRange(withDictionary, 120000, 5000, { dictionary })).equals(input.subarray(120000, 125000)));
+
+    const empty = await compressSeekable(Buffer.alloc(0));
+    assert.strictEqual(readRangeSync(empty, 0).length, 0);
+
+    await assert.rejects(readRange(compressSync(input), 0, 10), /Seek table not found/);
+    await assert.rejects(readRange(seekable, input.length + 1, 1), /outside/);
+    await assert.rejects(compressSeekable(input, { frameSize: 0 }), /frameSize/);
+    const damaged = Buffer.from(seekable);
+    damaged.writeUInt32LE(0xFFFFFF, damaged.length - 9 - 16);
+    assert.throws(() => readRangeSync(damaged, 0, 10), /Invalid seekable data/);
+
+    // Entry sizes are checked against the output limit and the frame headers
+    // before anything is allocated for them, whatever the requested range
+    const oversized = Buffer.from(seekable);
+    oversized.writeUInt32LE(0xFFFFFFF0, oversized.length - 9 - 5 * 8 + 4);
+    assert.throws(() => readRangeSync(oversized, 0, 1), /exceeds maximum/);
+    await assert.rejects(readRange(oversized, 0, 1), /exceeds maximum/);
+    const mismatched = Buffer.from(seekable);
+    mismatched.writeUInt32LE(300000 - 4 * 65536 + 1, mismatched.length - 9 - 8 + 4);
+    assert.throws(() => readRangeSync(mismatched, 299990, 5), /does not match the seek table/);
+};
+
+// Test 24: File to file
+const test24 = async () => {
+    const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'zstd-native-'));
+    try {
+        const input = Buffer.from('file contents line\n'.repeat(200000));
+        const src = path.join(dir, 'input.txt');
+        const packed = path.join(dir, 'input.txt.zst');
+        const unpacked = path.join(dir, 'output.txt');
+        fs.writeFileSync(src, input);
+
+        const written = await compressFile(src, packed, { level: 6, chunkSize: 4096 });
+        assert.strictEqual(written.bytesRead, input.length);
+        assert.strictEqual(written.bytesWritten, fs.statSync(packed).size);
+        // Mapped input is pledged, so the frame records its size
+        assert(decompressSync(fs.readFileSync(packed)).equals(input));
+
+        const read = await decompressFile(packed, unpacked);
+        assert.strictEqual(read.bytesWritten, input.length);
+        assert(fs.readFileSync(unpacked).equals(input));
+
+        // Stream output and existing destinations
+        fs.writeFileSync(packed, await pipeThrough([input], createZstdCompress()));
+        await decompressFile(packed, unpacked);
+        assert(fs.readFileSync(unpacked).equals(input));
+
+        const dictionary = new Dictionary(input.subarray(0, 2048));
+        await compressFile(src, packed, { dictionary });
+        await decompressFile(packed, unpacked, { dictionary });
+        assert(fs.readFileSync(unpacked).equals(input));
+
+        const empty = path.join(dir, 'empty');
+        fs.writeFileSync(empty, '');
+        await compressFile(empty, packed);
+        await decompressFile(packed, unpacked);
+        assert.strictEqual(fs.statSync(unpacked).size, 0);
+
+        // Failures leave no partial output
+        const truncated = path.join(dir, 'truncated.zst');
+        const whole = compressSync(input);
+        fs.writeFileSync(truncated, whole.subarray(0, whole.length - 10));
+        const broken = path.join(dir, 'broken.txt');
+        await assert.rejects(decompressFile(truncated, broken), /Truncated/);
+        assert(!fs.existsSync(broken));
+
+        await assert.rejects(compressFile(path.join(dir, 'missing'), packed), /Cannot open/);
+        await assert.rejects(compressFile(src, src), /same file/);
+        assert(fs.readFileSync(src).equals(input));
+        await assert.rejects(compressFile(42, packed), /path string/);
+    } finally {
+        fs.rmSync(dir, { recursive: true, force: true });
+    }
+};
+
+// Test 25: worker_threads
+const test25 = async () => {
+    // Each worker loads the addon, sets its own limit and shares a dictionary
+    const source = `
+        const { parentPort, workerData } = require('worker_threads');
+        const zstd = require(${JSON.stringify(path.join(__dirname, 'index.js'))});
+        (async () => {
+            zstd.setMaxInputSize(workerData.limit);
+            const dictionary = new zstd.Dictionary(Buffer.from(workerData.dictionary), 5);
+            const input = Buffer.from('worker payload '.repeat(50));
+            const packed = await zstd.zstdCompress(input, { dictionary });
+            const back = await zstd.zstdDecompress(packed, { dictionary });
+            let limited = false;
+            try { zstd.zstdCompressSync(Buffer.alloc(workerData.limit + 1)); } catch (e) { limited = /exceeds/.test(e.message); }
+            parentPort.postMessage({ ok: back.equals(input), limit: zstd.getLimits().maxInputSize, limited, packed });
+        })().catch(e => parentPort.postMessage({ error: e.message }));
+    `;
+    const dictionary = Buffer.from('worker payload dictionary '.repeat(20));
+    const results = await Promise.all([1, 2, 3, 4].map(i => new Promise((resolve, reject) => {
+        const worker = new Worker(source, { eval: true, workerData: { limit: 1000 * i, dictionary } });
+        worker.once('message', resolve);
+        worker.once('error', reject);
+    })));
+
+    results.forEach((result, i) => {
+        assert.strictEqual(result.error, undefined);
+        assert(result.ok);
+        assert(result.limited);
+        assert.strictEqual(result.limit, 1000 * (i + 1));
+    });
+
+    // Limits set in the workers stay there
+    assert.strictEqual(getLimits().maxInputSize, DEFAULT_MAX_OUTPUT_SIZE);
+
+    // Output from any worker decodes here with the same dictionary content
+    const shared = new Dictionary(dictionary, 5);
+    results.forEach(result => assert(decompressSync(Buffer.from(result.packed), { dictionary: shared }).length > 0));
+};
+
+// Test 26: TypedArray, DataView, ArrayBuffer and SharedArrayBuffer input
+const test26 = async () => {
+    const input = Buffer.from('shared memory pipeline '.repeat(400));
+    const packed = compressSync(input);
+
+    // Views are read at their byte offset, whatever their element type
+    const backing = new Uint8Array(input.length + 24);
+    backing.set(input, 8);
+    const view = backing.subarray(8, 8 + input.length);
+    assert(compressSync(view).equals(packed));
+    assert((await compress(view)).equals(packed));
+    const floats = new Float64Array(backing.buffer, 8, input.length / 8);
+    assert(decompressSync(compressSync(floats)).equals(input.subarray(0, floats.byteLength)));
+    assert(compressSync(new DataView(backing.buffer, 8, input.length)).equals(packed));
+
+    const arrayBuffer = packed.buffer.slice(packed.byteOffset, packed.byteOffset + packed.length);
+    assert((await decompress(arrayBuffer)).equals(input));
+
+    // A SharedArrayBuffer, bare or through a view, as input and output
+    const shared = new SharedArrayBuffer(packed.length);
+    new Uint8Array(shared).set(packed);
+    assert(decompressSync(shared).equals(input));
+    assert((await decompress(new Uint8Array(shared))).equals(input));
+
+    const region = new SharedArrayBuffer(compressBound(input.length) + 32);
+    const written = compressInto(input, region, 32);
+    assert(Buffer.from(region, 32, written).equals(packed));
+    const restored = new SharedArrayBuffer(input.length);
+    assert.strictEqual(decompressInto(new Uint8Array(region, 32, written), restored), input.length);
+    assert(Buffer.from(restored).equals(input));
+
+    const items = await compressBatch([view, arrayBuffer, new Uint8Array(shared)]);
+    assert(decompressSync(items[0]).equals(input));
+    assert(decompressSync(decompressSync(items[2])).equals(input));
+
+    assert.throws(() => compressSync('text'), /must be a Buffer, TypedArray, DataView or ArrayBuffer/);
+    assert.throws(() => compressSync({ length: 3 }), /must be a Buffer/);
+};
+
+// Test 27: Native stats
+const test27 = async () => {
+    const input = Buffer.from('counted bytes '.repeat(1000));
+    const before = getStats();
+
+    const packed = compressSync(input);
+    const after = getStats();
+    assert.strictEqual(after.compress.calls - before.compress.calls, 1);
+    assert.strictEqual(after.compress.bytesIn - before.compress.bytesIn, input.length);
+    assert.strictEqual(after.compress.bytesOut - before.compress.bytesOut, packed.length);
+    assert(after.compress.nanoseconds > before.compress.nanoseconds);
+    const pool = stats => stats.contextPool.compressHits + stats.contextPool.compressMisses;
+    assert.strictEqual(pool(after) - pool(before), 1);
+    assert(after.peakOutputAllocation >= packed.length);
+
+    await Promise.all([decompress(packed), decompress(packed), compress(input)]);
+    const done = getStats();
+    assert.strictEqual(done.decompress.calls - after.decompress.calls, 2);
+    assert.strictEqual(done.decompress.bytesOut - after.decompress.bytesOut, 2 * input.length);
+    assert.strictEqual(done.compress.bytesIn - after.compress.bytesIn, input.length);
+    assert(done.peakQueueDepth >= 1);
+    assert(done.queueDepth >= 0 && done.queueDepth <= done.peakQueueDepth);
+
+    // Streams count each step
+    await pipeThrough([input], createZstdCompress());
+    assert(getStats().compress.calls > done.compress.calls + 1);
+};
+
+// Test 28: Compression output sized by the result, not the bound
+const test28 = async () => {
+    // The bound of a compressible input may exceed the limit its output fits in
+    const text = Buffer.from('fits well under the limit '.repeat(10000));
+    try {
+        setMaxOutputSize(4096);
+        const packed = compressSync(text);
+        assert(packed.length <= 4096);
+        assert((await compress(text)).equals(packed));
+        setMaxOutputSize(DEFAULT_MAX_OUTPUT_SIZE);
+        assert(decompressSync(packed).equals(text));
+
+        setMaxOutputSize(4096);
+        assert.throws(() => compressSync(crypto.randomBytes(100000)), /Output size exceeds/);
+    } finally {
+        setMaxOutputSize(DEFAULT_MAX_OUTPUT_SIZE);
+    }
+
+    // Large inputs take the growing path and still record their size
+    const large = Buffer.alloc(9 * 1024 * 1024);
+    for (let i = 0; i < large.length; i += 4096) {
+        large.write(`block ${i} `, i);
+    }
+    const packed = await compress(large, { level: 1 });
+    assert(packed.length < large.length / 10);
+    assert(decompressSync(packed).equals(large));
+    assert.strictEqual(decompressInto(packed, Buffer.alloc(large.length)), large.length);
+    const random = crypto.randomBytes(9 * 1024 * 1024);
+    assert(decompressSync(compressSync(random)).equals(random));
+};
+
+// Test 29: Adaptive level
+const test29 = async () => {
+    const input = Buffer.from('adaptive level sample text '.repeat(2500));
+
+    // An unreachable speed target walks the level down to the floor
+    const slow = new Compressor({ level: 5, adapt: { targetThroughput: 1e12, minLevel: -3, maxLevel: 5 } });
+    assert.strictEqual(slow.level, 5);
+    for (let i = 0; i < 200 && slow.level > -3; i++) {
+        assert(decompressSync(slow.compressSync(input)).equals(input));
+    }
+    assert.strictEqual(slow.level, -3);
+
+    // A trivial one walks it up to the ceiling, skipping level 0
+    const fast = new Compressor({ level: -2, adapt: { targetThroughput: 0.001, maxLevel: 4 } });
+    const seen = new Set();
+    for (let i = 0; i < 200 && fast.level < 4; i++) {
+        await fast.compress(input);
+        seen.add(fast.level);
+    }
+    assert.strictEqual(fast.level, 4);
+    assert(!seen.has(0));
+
+    const tight = new Compressor({ level: 2, adapt: { maxLatency: 1e-9, minLevel: 1 } });
+    for (let i = 0; i < 100; i++) {
+        tight.compressSync(input);
+    }
+    assert.strictEqual(tight.level, 1);
+
+    // Streams restart the frame when the level changes; the output is the same data
+    const chunks = Array.from({ length: 64 }, (_, i) => Buffer.from(`chunk ${i} `.repeat(8000)));
+    const streamed = await pipeThrough(chunks,
+        createZstdCompress({ level: 3, adapt: { targetThroughput: 1e12, minLevel: -2 } }));
+    assert(decompressSync(streamed).equals(Buffer.concat(chunks)));
+
+    const items = await compressBatch(chunks, { adapt: { targetThroughput: 1e12 } });
+    items.forEach((item, i) => assert(decompressSync(item).equals(chunks[i])));
+
+    assert.throws(() => new Compressor({ adapt: true }), /adapt must be an object/);
+    assert.throws(() => new Compressor({ adapt: {} }), /needs targetThroughput or maxLatency/);
+    assert.throws(() => new Compressor({ adapt: { maxLatency: -1 } }), /positive number/);
+    assert.throws(() => new Compressor({ adapt: { targetThroughput: 1, minLevel: 5, maxLevel: 1 } }), /must not exceed/);
+};
+
+// Test 30: Parallel decoding of seekable data
+const test30 = async () => {
+    const input = Buffer.alloc(3 * 1024 * 1024 + 12345);
+    for (let i = 0; i < input.length; i += 64) {
+        input.write(`line ${i} of the snapshot `, i);
+    }
+    const chunked = await compressSeekable(input, { level: 3, frameSize: 256 * 1024, checksumFlag: true });
+    assert.strictEqual(chunked.readUInt32LE(chunked.length - 9), 13);
+
+    // zstdDecompress splits the frames across the threadpool; the sync path
+    // decodes the same data frame by frame
+    assert((await decompress(chunked)).equals(input));
+    assert(decompressSync(chunked).equals(input));
+    assert(readRangeSync(chunked, 1000000, 300000).equals(input.subarray(1000000, 1300000)));
+
+    const dictionary = new Dictionary(input.subarray(0, 8192));
+    const withDictionary = await compressSeekable(input, { dictionary, frameSize: 1024 * 1024 });
+    assert((await decompress(withDictionary, { dictionary })).equals(input));
+
+    // Limits still apply to the whole content
+    try {
+        setMaxOutputSize(input.length - 1);
+        await assert.rejects(decompress(chunked), /Output size/);
+    } finally {
+        setMaxOutputSize(DEFAULT_MAX_OUTPUT_SIZE);
+    }
+
+    // A corrupt frame fails the whole call
+    const damaged = Buffer.from(chunked);
+    damaged[damaged.length >> 1] ^= 0xff;
+    await assert.rejects(decompress(damaged), /Decompression failed|Invalid/);
+
+    // Frames the table does not cover fall back to sequential decoding
+    const prefixed = Buffer.concat([compressSync(Buffer.from('prefix')), chunked]);
+    assert((await decompress(prefixed)).equals(Buffer.concat([Buffer.from('prefix'), input])));
+};
+
+// Test 31: Frame inspection
+const test31 = async () => {
+    const input = Buffer.from('inspect the header only '.repeat(500));
+    const single = compressSync(input, { level: 3, checksumFlag: true, windowLog: 20 });
+    const info = getFrameInfo(single);
+    assert.strictEqual(info.frames.length, 1);
+    assert.strictEqual(info.contentSize, input.length);
+    assert.strictEqual(info.compressedSize, single.length);
+    const [frame] = info.frames;
+    assert.strictEqual(frame.type, 'zstd');
+    assert.strictEqual(frame.offset, 0);
+    assert.strictEqual(frame.compressedSize, single.length);
+    assert.strictEqual(frame.checksum, true);
+    assert.strictEqual(frame.dictionaryId, 0);
+    assert(frame.windowSize > 0 && frame.headerSize > 0);
+
+    // Unknown sizes, dictionaries, concatenated and skippable frames
+    const streamed = await pipeThrough([input], createZstdCompress());
+    const samples = Array.from({ length: 2000 }, (_, i) => Buffer.from(JSON.stringify({ id: i, kind: ['a', 'b'][i % 2] })));
+    const dictionary = new Dictionary(await trainDictionary(samples, 4096, { dictID: 4321 }));
+    const withDictionary = compressSync(input, { dictionary });
+    const many = getFrameInfo(Buffer.concat([single, streamed, withDictionary]));
+    assert.deepStrictEqual(many.frames.map(f => f.offset), [0, single.length, single.length + streamed.length]);
+    assert.strictEqual(many.frames[1].contentSize, null);
+    assert.strictEqual(many.contentSize, null);
+    assert.strictEqual(many.frames[2].dictionaryId, 4321);
+    assert.strictEqual(dictionary.id, 4321);
+
+    const seekable = await compressSeekable(input, { frameSize: 4096 });
+    const table = getFrameInfo(seekable);
+    const last = table.frames[table.frames.length - 1];
+    assert.strictEqual(last.type, 'skippable');
+    assert.strictEqual(last.magicVariant, 0xE);
+    assert.strictEqual(last.seekTable, true);
+    assert.strictEqual(table.contentSize, input.length);
+    assert.strictEqual(table.frames.length, Math.ceil(input.length / 4096) + 1);
+
+    assert.deepStrictEqual(getFrameInfo(Buffer.alloc(0)).frames, []);
+    assert.throws(() => getFrameInfo(single.subarray(0, single.length - 1)), /Invalid compressed data at offset 0/);
+    assert.throws(() => getFrameInfo(Buffer.from('not zstd')), /Invalid compressed data/);
+    assert.throws(() => getFrameInfo('x'), /must be a Buffer/);
+};
+
+// Test 32: Delta compression against a base version
+const test32 = async () => {
+    const records = Array.from({ length: 20000 }, (_, i) => ({ id: i, name: `user-${i}`, score: (i * 7919) % 1000 }));
+    const v1 = Buffer.from(JSON.stringify(records));
+    records[1234].score = -1;
+    records.push({ id: 20000, name: 'new', score: 0 });
+    const v2 = Buffer.from(JSON.stringify(records));
+
+    const patch = await compressDelta(v2, v1, 3);
+    const independent = await compress(v2, 3);
+    assert(patch.length * 10 < independent.length, `delta ${patch.length} vs ${independent.length}`);
+    assert(v2.equals(await decompressDelta(patch, v1)));
+    assert.strictEqual(getFrameInfo(patch).contentSize, v2.length);
+
+    // The base is required and must be the same bytes
+    await assert.rejects(decompress(patch), /Decompression failed/);
+    await assert.rejects(decompressDelta(patch, v1.subarray(0, 64)), /Decompression failed/);
+
+    // Large base: the window is widened and frames still decode
+    const big = crypto.randomBytes(8 << 20);
+    const edited = Buffer.concat([big.subarray(0, 4 << 20), Buffer.from('inserted'), big.subarray(4 << 20)]);
+    const bigPatch = await compressDelta(new Uint8Array(edited), big, { level: 1 });
+    assert(bigPatch.length < 64 * 1024, `large delta is ${bigPatch.length} bytes`);
+    assert(getFrameInfo(bigPatch).frames[0].windowSize >= big.length);
+    assert(edited.equals(await decompressDelta(bigPatch, new DataView(big.buffer, big.byteOffset, big.length))));
+
+    // Pooled contexts do not keep the prefix
+    const plain = await compress(v2, 3);
+    assert(v2.equals(decompressSync(plain)));
+    assert.strictEqual(plain.length, independent.length);
+
+    assert((await compressDelta(Buffer.alloc(0), v1)).length === 0);
+    assert(v2.equals(await decompressDelta(await compressDelta(v2, Buffer.alloc(0)), Buffer.alloc(0))));
+    await assert.rejects(compressDelta(v2, 'base'), /Base must be a Buffer/);
+    await assert.rejects(compressDelta(v2, v1, { dictionary: new Dictionary(v1) }), /does not take a dictionary/);
+};
+
+// Test 33: Memory budget
+const test33 = async () => {
+    const before = getMemoryUsage();
+    assert.strictEqual(before.budget, 0);
+    assert.strictEqual(before.total, before.contexts + before.dictionaries + before.buffers);
+    assert(before.contexts > 0, 'pooled contexts are charged');
+
+    const small = estimateMemory(19, 1000);
+    const large = estimateMemory({ level: 19 }, 1 << 20);
+    assert(small.compress > 0 && small.compress < large.compress);
+    assert(estimateMemory(19).compress >= large.compress);
+    assert(large.compressStream >= large.compress);
+    assert(large.decompress > 0 && large.decompressStream > large.decompress);
+    assert.throws(() => estimateMemory(3, 'big'), /Size must be a number/);
+
+    const dictionary = new Dictionary(Buffer.from('shared dictionary content '.repeat(200)), 7);
+    assert(getMemoryUsage().dictionaries >= before.dictionaries + 5000);
+
+    const input = crypto.randomBytes(1 << 20);
+    const zeros = compressSync(Buffer.alloc(16 << 20));
+    const compressor = new Compressor(22);
+    try {
+        setMemoryBudget(getMemoryUsage().total + (4 << 20));
+        assert(getMemoryUsage().budget > 0);
+        // A fresh level-22 context for 1 MiB needs ~18 MB
+        await assert.rejects(compressor.compress(input), /Memory budget of \d+ bytes exceeded/);
+        // A buffer that would pass the budget is refused before it is allocated
+        await assert.rejects(decompress(zeros), /Memory budget/);
+        assert(getMemoryUsage().rejected >= before.rejected + 2);
+
+        // Work that fits still runs
+        const text = Buffer.from('within budget '.repeat(100));
+        assert(text.equals(await decompress(await compress(text, 1))));
+        assert(text.equals(decompressSync(compressSync(text, { dictionary }), { dictionary })));
+    } finally {
+        setMemoryBudget(0);
+    }
+    assert.strictEqual(getMemoryUsage().budget, 0);
+    assert(input.equals(await decompress(await compressor.compress(input))));
+    assert(getMemoryUsage().peak >= getMemoryUsage().total);
+    assert.throws(() => setMemoryBudget(-1), /Memory budget/);
+    assert.throws(() => setMemoryBudget('1'), /Expected a number/);
+};
+
+// Test 34: Buffer pool
+const test34 = async () => {
+    const input = Buffer.from('recycled output blocks '.repeat(4000));
+    configureBufferPool({ maxIdleBytes: 8 << 20, maxBlockSize: 1 << 20 });
+    try {
+        const start = getStats().bufferPool;
+        for (let i = 0; i < 20; i++) {
+            const compressed = await compress(input, 1);
+            const restored = await decompress(compressed);
+            assert(input.equals(restored));
+        }
+        // Bound-sized compression blocks are released when shrunk
+        const { bufferPool } = getStats();
+        assert(bufferPool.hits > start.hits, 'blocks are recycled');
+        assert(bufferPool.idleBytes <= 8 << 20);
+        assert.strictEqual(getMemoryUsage().buffers >= bufferPool.idleBytes, true);
+
+        // Growing output moves between classes; larger blocks are not pooled
+        const big = Buffer.alloc(3 << 20, 7);
+        assert(big.equals(await pipeThrough([compressSync(big)], createZstdDecompress())));
+        assert(big.equals(await decompress(compressSync(big))));
+
+        // Unpooled bound-sized blocks resized into a pooled class keep
+        // only their written bytes
+        const repetitive = Buffer.alloc(8 << 20, 'seekable ');
+        const seekable = await compressSeekable(repetitive, { frameSize: 2 << 20 });
+        assert(seekable.length < 1 << 20);
+        assert(repetitive.equals(decompressSync(seekable)));
+        assert(repetitive.subarray(5 << 20, (5 << 20) + 100).equals(readRangeSync(seekable, 5 << 20, 100)));
+    } finally {
+        configureBufferPool();
+    }
+    assert.strictEqual(getStats().bufferPool.idleBytes, 0);
+    assert(input.equals(await decompress(await compress(input))));
+    assert.throws(() => configureBufferPool(5), /must be an object/);
+};
+
+// Test 36: Small inputs and raw fallback
+const test36 = async () => {
+    const message = Buffer.from(JSON.stringify({ id: 42, type: 'event', payload: 'x'.repeat(200) }));
+    assert(message.length <= 1024);
+    const before = getStats();
+    const packed = await compress(message);
+    assert(packed.equals(compressSync(message)));
+    assert(message.equals(await decompress(packed)));
+    assert(message.equals(decompressSync(packed)));
+    const after = getStats();
+    assert.strictEqual(after.compress.calls - before.compress.calls, 2);
+    assert.strictEqual(after.decompress.calls - before.decompress.calls, 2);
+    assert.strictEqual(after.peakOutputAllocation, before.peakOutputAllocation);
+
+    // Larger input takes a context only on the thread that decodes it
+    const contexts = () => {
+        const { contextPool } = getStats();
+        return contextPool.decompressHits + contextPool.decompressMisses;
+    };
+    const large = compressSync(crypto.randomBytes(64 * 1024));
+    const taken = contexts();
+    await decompress(large);
+    assert.strictEqual(contexts() - taken, 1);
+    decompressSync(large);
+    assert.strictEqual(contexts() - taken, 2);
+
+    // Limits and errors still apply on the inline path
+    try {
+        setMaxOutputSize(10);
+        await assert.rejects(compress(message), /Output size exceeds/);
+        assert.throws(() => decompressSync(packed), /Output size/);
+    } finally {
+        setMaxOutputSize(DEFAULT_MAX_OUTPUT_SIZE);
+    }
+    await assert.rejects(decompress(packed.subarray(0, packed.length - 2)), /Invalid compressed data/);
+    assert(Buffer.alloc(0).equals(await compress(Buffer.alloc(0))));
+
+    // Calls with setup to do first still leave the event loop
+    const dictionary = new Dictionary(Buffer.from('event payload id type '.repeat(64)), 3);
+    for (const options of [{ dictionary, level: 19 }, { workers: 2 }, { adapt: { maxLatency: 5 } }]) {
+        const depth = getStats().queueDepth;
+        const pending = compress(message, options);
+        assert.strictEqual(getStats().queueDepth, depth + 1);
+        assert(message.equals(await decompress(await pending, { dictionary: options.dictionary })));
+    }
+    // Once digested, the dictionary's level is served inline
+    const depth = getStats().queueDepth;
+    const inline = compress(message, { dictionary, level: 19 });
+    assert.strictEqual(getStats().queueDepth, depth);
+    await inline;
+
+    // Incompressible input is stored behind a one-byte marker
+    for (const noise of [crypto.randomBytes(300), crypto.randomBytes(64 * 1024)]) {
+        const stored = await compress(noise, { rawFallback: true });
+        assert.strictEqual(stored.length, noise.length + 1);
+        assert.strictEqual(stored[0], 0);
+        assert(noise.equals(await decompress(stored, { rawFallback: true })));
+        assert(noise.equals(decompressSync(stored, { rawFallback: true })));
+        assert(noise.equals((await decompressBatch([stored], { rawFallback: true }))[0]));
+        await assert.rejects(decompress(stored), /Invalid compressed data/);
+    }
+    // The stored form counts against the output limit too
+    try {
+        setMaxOutputSize(300);
+        const noise = crypto.randomBytes(300);
+        assert.throws(() => compressSync(noise, { rawFallback: true }), /Output size exceeds/);
+        await assert.rejects(compress(noise, { rawFallback: true }), /Output size exceeds/);
+    } finally {
+        setMaxOutputSize(DEFAULT_MAX_OUTPUT_SIZE);
+    }
+    // Compressible input still yields a zstd frame
+    const framed = compressSync(message, { rawFallback: true });
+    assert(framed.equals(packed));
+    assert(message.equals(decompressSync(framed, { rawFallback: true })));
+    assert.throws(() => compressSync(message, { rawFallback: 1 }), /rawFallback must be a boolean/);
+    await assert.rejects(compressDelta(message, message, { rawFallback: true }), /does not take rawFallback/);
+};
+
+// Test 37: Async iterators and Web Streams
+const test37 = async () => {
+    const { ReadableStream } = require('stream/web');
+    const chunks = [];
+    for (let i = 0; i < 100; i++) {
+        chunks.push(Buffer.from(`record ${i}: ${'y'.repeat(i)}\n`.repeat(50)));
+    }
+    const input = Buffer.concat(chunks);
+    const collect = async (iterable) => {
+        const out = [];
+        for await (const chunk of iterable) {
+            out.push(chunk);
+        }
+        return Buffer.concat(out);
+    };
+
+    // Generators, with async sources, strings and small windows
+    const compressed = await collect(compressChunks(Readable.from(chunks), { level: 5 }));
+    assert(input.equals(decompressSync(compressed)));
+    assert(input.equals(await collect(decompressChunks([compressed], { chunkSize: 1024 }))));
+    assert(Buffer.from('abcdef').equals(decompressSync(await collect(compressChunks(['abc', 'def'])))));
+    assert.strictEqual((await collect(decompressChunks(compressChunks([])))).length, 0);
+    await assert.rejects(collect(decompressChunks([compressed.subarray(0, compressed.length - 4)])), /Truncated/);
+    for await (const chunk of decompressChunks([compressed], { chunkSize: 1024 })) {
+        assert(chunk.length > 0 && chunk.length <= 1024);
+        break;
+    }
+
+    // Web Streams
+    const body = () => new ReadableStream({
+        start(controller) {
+            chunks.forEach(chunk => controller.enqueue(new Uint8Array(chunk)));
+            controller.close();
+        }
+    });
+    const packed = await collect(body().pipeThrough(new ZstdCompressionStream({ level: 5 })));
+    assert(input.equals(decompressSync(packed)));
+    const unpacked = await collect(body()
+        .pipeThrough(new ZstdCompressionStream())
+        .pipeThrough(new ZstdDecompressionStream({ chunkSize: 4096 })));
+    assert(input.equals(unpacked));
+
+    // A write does not settle until its chunk has been read out
+    const stream = new ZstdDecompressionStream({ chunkSize: 1024 });
+    const writer = stream.writable.getWriter();
+    let written = false;
+    writer.write(compressed).then(() => { written = true; });
+    await new Promise(resolve => setTimeout(resolve, 50));
+    assert(!written);
+    const drained = collect(stream.readable);
+    await writer.close();
+    assert(written);
+    assert(input.equals(await drained));
+
+    // Errors reach both sides; cancelling stops the pending write
+    const broken = new ZstdDecompressionStream();
+    const brokenWrite = broken.writable.getWriter().write(Buffer.from('not zstd data'));
+    await assert.rejects(collect(broken.readable), /Decompression failed/);
+    await assert.rejects(brokenWrite);
+    const cancelled = new ZstdDecompressionStream({ chunkSize: 1024 });
+    const pendingWrite = cancelled.writable.getWriter().write(compressed);
+    const reader = cancelled.readable.getReader();
+    await reader.read();
+    await reader.cancel(new Error('client went away'));
+    await assert.rejects(pendingWrite, /client went away/);
+};
+
+// Test 38: Cancellation and deadlines
+const test38 = async () => {
+    const input = crypto.randomBytes(256 * 1024).toString('hex').repeat(8); // 4 MiB
+    const data = Buffer.from(input);
+    const reused = Buffer.from(data);
+    const packed = compressSync(data, 19);
+
+    // Cancellable calls produce the same bytes as the one-shot path
+    const done = new AbortController();
+    assert(packed.equals(await compress(data, { level: 19, signal: done.signal })));
+    assert(data.equals(await decompress(packed, { signal: done.signal, deadlineMs: 60000 })));
+    assert(data.equals(decompressSync(packed, { deadlineMs: 60000 })));
+    assert(packed.equals(compressSync(data, { level: 19, deadlineMs: 60000 })));
+
+    // Aborted while running: stops at the next step
+    const controller = new AbortController();
+    const started = process.hrtime.bigint();
+    const running = compress(data, { level: 19, signal: controller.signal });
+    setTimeout(() => controller.abort(new Error('client left')), 20);
+    const aborted = await running.then(() => null, error => error);
+    assert(aborted, 'level 19 on 4 MiB should outlast 20 ms');
+    assert.strictEqual(aborted.name, 'AbortError');
+    assert.strictEqual(aborted.code, 'ABORT_ERR');
+    assert.strictEqual(aborted.cause.message, 'client left');
+    assert(Number(process.hrtime.bigint() - started) / 1e6 < 2000);
+
+    // Already aborted or expired: no work is done
+    const signal = AbortSignal.abort();
+    await assert.rejects(compress(data, { signal }), { name: 'AbortError' });
+    await assert.rejects(compress(Buffer.from('tiny'), { signal }), { name: 'AbortError' });
+    await assert.rejects(decompress(packed, { signal }), { name: 'AbortError' });
+    assert.throws(() => compressSync(data, { signal }), { name: 'AbortError' });
+    await assert.rejects(compress(data, { level: 19, deadlineMs: 5 }), { name: 'TimeoutError', code: 'ETIMEDOUT' });
+    await assert.rejects(decompress(packed, { deadlineMs: 0 }), /Deadline of 0 ms exceeded/);
+    await assert.rejects(compressBatch([data, data], { level: 19, deadlineMs: 5 }), { name: 'TimeoutError' });
+    await assert.rejects(decompressBatch([packed], { signal }), /Item 0: The operation was aborted/);
+
+    // A cancelled file call leaves no destination behind
+    const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'zstd-cancel-'));
+    try {
+        const src = path.join(dir, 'in');
+        const dst = path.join(dir, 'out.zst');
+        fs.writeFileSync(src, data);
+        await assert.rejects(compressFile(src, dst, { level: 19, deadlineMs: 5 }), { name: 'TimeoutError' });
+        assert(!fs.existsSync(dst));
+    } finally {
+        fs.rmSync(dir, { recursive: true, force: true });
+    }
+
+    // The pooled contexts are left clean for the next call
+    assert(packed.equals(await compress(reused, 19)));
+    assert(data.equals(await decompress(packed)));
+
+    assert.throws(() => compressSync(data, { signal: {} }), /must be an AbortSignal/);
+    assert.throws(() => compressSync(data, { deadlineMs: -1 }), /deadlineMs must be a non-negative number/);
+};
+
+// Test 39: Native thread pool
+const test39 = async () => {
+    const small = Buffer.from(crypto.randomBytes(2048).toString('hex')); // 4 KiB
+    const large = Buffer.from(crypto.randomBytes(512 * 1024).toString('hex').repeat(4)); // 4 MiB
+
+    assert.deepStrictEqual(configureThreadPool({ threads: 2 }),
+        { threads: 2, latencyThreads: 1, latencyJobSize: 65536 });
+    try {
+        const before = getStats().threadPool;
+        assert.strictEqual(before.threads, 2);
+
+        // Small jobs complete while bulk ones occupy the general thread
+        const bulk = [compress(large, 19), compress(large, 19)];
+        assert.throws(() => configureThreadPool({ threads: 4 }), /Thread pool is busy/);
+        for (let i = 0; i < 8; i++) {
+            assert(small.equals(await decompress(await compress(small))));
+        }
+        const packed = await Promise.all(bulk);
+        assert(large.equals(await decompress(packed[0])));
+
+        const batch = await compressBatch([small, large, small]);
+        assert(large.equals((await decompressBatch(batch))[1]));
+
+        const compressor = new Compressor(3);
+        assert(small.equals(await decompress(await compressor.compress(small))));
+
+        // An environment torn down with jobs queued and running takes them
+        // back out of the pool
+        const worker = new Worker(`
+            const { parentPort } = require('worker_threads');
+            const zstd = require(${JSON.stringify(path.join(__dirname, 'index.js'))});
+            const large = Buffer.from(require('crypto').randomBytes(512 * 1024).toString('hex').repeat(4));
+            for (let i = 0; i < 6; i++) {
+                zstd.zstdCompress(large, 19);
+            }
+            parentPort.postMessage(zstd.getStats().threadPool.queued.bulk);
+        `, { eval: true });
+        assert(await new Promise((resolve, reject) => {
+            worker.once('message', resolve);
+            worker.once('error', reject);
+        }) > 0);
+        await worker.terminate();
+        assert.deepStrictEqual(getStats().threadPool.queued, { latency: 0, bulk: 0 });
+        assert.strictEqual(getStats().threadPool.running, 0);
+
+        const after = getStats().threadPool;
+        assert(after.completed.latency - before.completed.latency >= 9);
+        assert(after.completed.bulk - before.completed.bulk >= 3);
+        assert.deepStrictEqual(after.queued, { latency: 0, bulk: 0 });
+        assert.strictEqual(after.running, 0);
+        assert(after.steals >= 0);
+    } finally {
+        configureThreadPool({ threads: 0 });
+    }
+    assert.strictEqual(getStats().threadPool.threads, 0);
+    assert(small.equals(await decompress(await compress(small))));
+
+    if (process.platform === 'linux') {
+        assert.strictEqual(configureThreadPool({ threads: 1, affinity: [0] }).latencyThreads, 0);
+        assert(small.equals(await decompress(await compress(small))));
+        configureThreadPool({ threads: 0 });
+    }
+    assert.throws(() => configureThreadPool({ affinity: [-1] }), /array of CPU numbers/);
+    assert.throws(() => configureThreadPool({ threads: 2, latencyThreads: 2 }), /less than threads/);
+    assert.throws(() => configureThreadPool(5), /must be an object/);
+    assert.strictEqual(getStats().threadPool.threads, 0);
+};
+
+// Test 40: Checksums and output digests
+const test40 = async () => {
+    const crc32c = (data) => {
+        let crc = ~0;
+        for (const byte of data) {
+            crc ^= byte;
+            for (let bit = 0; bit < 8; bit++) {
+                crc = (crc >>> 1) ^ (0x82F63B78 & -(crc & 1));
+            }
+        }
+        return (~crc >>> 0).toString(16).padStart(8, '0');
+    };
+
+    // Known vectors: the CRC32C check value, XXH64 of nothing
+    const check = Buffer.from('123456789');
+    assert.deepStrictEqual(decompressSync(compressSync(check), { digest: 'crc32c' }), { buffer: check, digest: 'e3069283' });
+    assert.strictEqual((await decompress(Buffer.alloc(0), { digest: 'xxh64' })).digest, 'ef46db3751d8e999');
+
+    const data = Buffer.from(crypto.randomBytes(128 * 1024).toString('hex').repeat(4)); // 1 MiB
+    const packed = compressSync(data, { level: 3, checksumFlag: true });
+    const crc = await decompress(packed, { digest: 'crc32c' });
+    assert(crc.buffer.equals(data));
+    assert.strictEqual(crc.digest, crc32c(data));
+
+    // A single frame's checksum is the low 32 bits of its XXH64, little-endian
+    const xxh = decompressSync(packed, { digest: 'xxh64' });
+    assert(xxh.buffer.equals(data));
+    assert.strictEqual(xxh.digest.slice(8), packed.readUInt32LE(packed.length - 4).toString(16).padStart(8, '0'));
+    assert.strictEqual((await decompress(packed, { digest: 'xxh64' })).digest, xxh.digest);
+
+    // Seekable and unsized frames are digested the same way
+    assert.strictEqual((await decompress(await compressSeekable(data, { frameSize: 64 * 1024 }), { digest: 'xxh64' })).digest, xxh.digest);
+
+    // Checksum verification and the trusted fast path
+    const corrupt = Buffer.from(packed);
+    corrupt[corrupt.length - 1] ^= 0xFF;
+    await assert.rejects(decompress(corrupt), /checksum/);
+    assert.throws(() => decompressSync(corrupt), /checksum/);
+    assert(data.equals(await decompress(corrupt, { ignoreChecksum: true })));
+    assert(data.equals(decompressSync(corrupt, { ignoreChecksum: true })));
+    assert((await decompressBatch([corrupt], { ignoreChecksum: true }))[0].equals(data));
+
+    // Every stream interface verifies by default and takes ignoreChecksum
+    const collect = async (iterable) => {
+        const out = [];
+        for await (const chunk of iterable) {
+            out.push(chunk);
+        }
+        return Buffer.concat(out);
+    };
+    const { ReadableStream } = require('stream/web');
+    const webBody = () => new ReadableStream({
+        start(controller) {
+            controller.enqueue(new Uint8Array(corrupt));
+            controller.close();
+        }
+    });
+    await assert.rejects(pipeThrough([corrupt], createZstdDecompress()), /checksum/);
+    assert(data.equals(await pipeThrough([corrupt], createZstdDecompress({ ignoreChecksum: true }))));
+    await assert.rejects(collect(decompressChunks([corrupt])), /checksum/);
+    assert(data.equals(await collect(decompressChunks([corrupt], { ignoreChecksum: true }))));
+    await assert.rejects(collect(webBody().pipeThrough(new ZstdDecompressionStream())), /checksum/);
+    assert(data.equals(await collect(webBody().pipeThrough(new ZstdDecompressionStream({ ignoreChecksum: true })))));
+    assert(data.equals(await decompress(packed)));
+
+    const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'zstd-digest-'));
+    try {
+        const src = path.join(dir, 'in');
+        fs.writeFileSync(src, data);
+        const compressed = await compressFile(src, path.join(dir, 'in.zst'), { digest: 'crc32c' });
+        assert.strictEqual(compressed.digest, crc32c(fs.readFileSync(path.join(dir, 'in.zst'))));
+        const restored = await decompressFile(path.join(dir, 'in.zst'), path.join(dir, 'out'), { digest: 'xxh64' });
+        assert.strictEqual(restored.digest, xxh.digest);
+        assert.strictEqual(restored.bytesWritten, data.length);
+
+        fs.writeFileSync(src, corrupt);
+        await assert.rejects(decompressFile(src, path.join(dir, 'bad')), /checksum/);
+        await decompressFile(src, path.join(dir, 'trusted'), { ignoreChecksum: true });
+        assert(data.equals(fs.readFileSync(path.join(dir, 'trusted'))));
+    } finally {
+        fs.rmSync(dir, { recursive: true, force: true });
+    }
+
+    assert(Buffer.isBuffer(decompressSync(packed)));
+    assert.throws(() => decompressSync(packed, { digest: 'md5' }), /must be 'xxh64' or 'crc32c'/);
+    await assert.rejects(decompress(packed, { digest: 1 }), /must be 'xxh64' or 'crc32c'/);
+};
+
+// Test 35: Static context arena (runs last: it is configured once per process)
+const test35 = async () => {
+    const arena = configureContextArena({ level: 5, maxInputSize: 1 << 20, slots: 64 });
+    assert.strictEqual(arena.slots, 64);
+    assert(arena.compressSlotSize >= estimateMemory(5, 1 << 20).compress);
+    assert.strictEqual(arena.bytes, 64 * (arena.compressSlotSize + arena.decompressSlotSize));
+    assert.throws(() => configureContextArena(3), /already configured/);
+
+    const input = Buffer.from(JSON.stringify(Array.from({ length: 20000 }, (_, i) => ({ i, even: i % 2 === 0 }))));
+    assert(input.length < 1 << 20);
+    for (let i = 0; i < 8; i++) {
+        assert(input.equals(await decompress(await compress(input, 5))));
+        assert(input.equals(decompressSync(compressSync(input, 3))));
+    }
+    const batch = await compressBatch([input, input, input], 5);
+    assert(input.equals((await decompressBatch(batch))[2]));
+
+    // Slots are sized for level 5 and 1 MiB; more is refused, not allocated
+    await assert.rejects(compress(crypto.randomBytes(4 << 20), 19), /Compression failed/);
+    await assert.rejects(compress(input, { level: 5, workers: 2 }), /single-threaded/);
 };
 
 async function runTests() {
@@ -156,6 +1462,38 @@ async function runTests() {
         await test('Large valid compression', test6);
         await test('Output size limits', test7);
         await test('Constants availability', test8);
+        await test('Synchronous variants', test9);
+        await test('Non-blocking async work', test10);
+        await test('Compressor/Decompressor contexts', test11);
+        await test('Zero-copy output buffers', test12);
+        await test('Compress/decompress into caller memory', test13);
+        await test('Streaming round trip', test14);
+        await test('Stream flush', test15);
+        await test('Dictionary compression', test16);
+        await test('Dictionary training', test17);
+        await test('Multithreaded compression', test18);
+        await test('Advanced parameters', test19);
+        await test('Batch API', test20);
+        await test('Per-instance limits', test21);
+        await test('Unknown size and multi-frame input', test22);
+        await test('Seekable format', test23);
+        await test('File to file', test24);
+        await test('worker_threads', test25);
+        await test('TypedArray and SharedArrayBuffer input', test26);
+        await test('Native stats', test27);
+        await test('Tight compression output', test28);
+        await test('Adaptive level', test29);
+        await test('Parallel seekable decoding', test30);
+        await test('Frame inspection', test31);
+        await test('Delta compression', test32);
+        await test('Memory budget', test33);
+        await test('Buffer pool', test34);
+        await test('Small inputs and raw fallback', test36);
+        await test('Async iterators and Web Streams', test37);
+        await test('Cancellation and deadlines', test38);
+        await test('Native thread pool', test39);
+        await test('Checksums and output digests', test40);
+        await test('Static context arena', test35);
         
         console.log('\nAll tests passed! ✨');
     } catch (error) {
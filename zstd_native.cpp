@@ -6,80 +6,4850 @@
  */
 
 #include <napi.h>
+#define ZSTD_STATIC_LINKING_ONLY // ZSTD_c_targetCBlockSize before libzstd 1.5.6
 #include <zstd.h>
+#include <zstd_errors.h>
+#define ZDICT_STATIC_LINKING_ONLY // ZDICT_optimizeTrainFromBuffer_fastCover
+#include <zdict.h>
 #include <vector>
 #include <stdexcept>
 #include <cstdint>
+#include <climits>
 #include <mutex>
+#include <optional>
+#include <memory>
+#include <cstdlib>
+#include <map>
+#include <cstring>
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include <string_view>
+#include <tuple>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cerrno>
+#include <deque>
+#include <condition_variable>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
 
 namespace {
-    // Constants for compression
+    // Constants for compression; the level range comes from the linked
+    // libzstd (ZSTD_minCLevel()..ZSTD_maxCLevel()), negative levels included
     constexpr int DEFAULT_LEVEL = 3;
-    constexpr int MIN_LEVEL = 1;
-    constexpr int MAX_LEVEL = 22;
     
     // Default size limits (2GB)
     constexpr size_t DEFAULT_MAX_INPUT_SIZE = 1ULL << 31;
     constexpr size_t DEFAULT_MAX_OUTPUT_SIZE = 1ULL << 31;
 
-    // Configurable size limits with thread-safe access
-    std::mutex g_size_mutex;
-    size_t g_max_input_size = DEFAULT_MAX_INPUT_SIZE;
-    size_t g_max_output_size = DEFAULT_MAX_OUTPUT_SIZE;
+    // Limits snapshotted once per call (or per batch) and passed down
+    struct SizeLimits {
+        size_t maxInput;
+        size_t maxOutput;
+    };
+
+    // The size limits of the calling environment (main thread or
+    // worker_thread), kept in the addon instance data below. They are only
+    // touched on that environment's JS thread; workers get a snapshot.
+    SizeLimits currentLimits(Napi::Env env);
+
+    // Per-instance caps from the Compressor/Decompressor options; a cap that
+    // is not set follows the environment's limit at call time.
+    struct LimitOverrides {
+        std::optional<size_t> maxInput;
+        std::optional<size_t> maxOutput;
+
+        SizeLimits resolve(Napi::Env env) const {
+            const SizeLimits global = currentLimits(env);
+            return { maxInput.value_or(global.maxInput), maxOutput.value_or(global.maxOutput) };
+        }
+    };
+
+    // Process-wide counters behind getStats(). Each thread owns one shard and
+    // is its only writer, so a bump is a relaxed load and store on a cache
+    // line no other thread writes; getStats() sums the shards. Shards are
+    // never freed, so the totals keep the work of threads that have exited.
+    enum StatCounter {
+        STAT_COMPRESS_CALLS,
+        STAT_COMPRESS_BYTES_IN,
+        STAT_COMPRESS_BYTES_OUT,
+        STAT_COMPRESS_NANOS,
+        STAT_DECOMPRESS_CALLS,
+        STAT_DECOMPRESS_BYTES_IN,
+        STAT_DECOMPRESS_BYTES_OUT,
+        STAT_DECOMPRESS_NANOS,
+        STAT_CCTX_HITS,
+        STAT_CCTX_MISSES,
+        STAT_DCTX_HITS,
+        STAT_DCTX_MISSES,
+        STAT_COUNTERS
+    };
+
+    struct alignas(64) StatShard {
+        std::atomic<uint64_t> values[STAT_COUNTERS] = {};
+    };
+
+    class StatRegistry {
+    public:
+        StatShard& shard() {
+            thread_local StatShard* local = nullptr;
+            if (!local) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                shards_.push_back(std::make_unique<StatShard>());
+                local = shards_.back().get();
+            }
+            return *local;
+        }
+
+        void sum(uint64_t (&totals)[STAT_COUNTERS]) {
+            std::fill(std::begin(totals), std::end(totals), 0);
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& shard : shards_) {
+                for (int i = 0; i < STAT_COUNTERS; i++) {
+                    totals[i] += shard->values[i].load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Asynchronous jobs queued or running, across every environment
+        std::atomic<int64_t> queueDepth{0};
+        std::atomic<int64_t> peakQueueDepth{0};
+        // Largest single output block allocated or grown to
+        std::atomic<uint64_t> peakOutputAllocation{0};
+
+    private:
+        std::mutex mutex_;
+        std::vector<std::unique_ptr<StatShard>> shards_;
+    };
+
+    StatRegistry& stats() {
+        // Leaked so worker threads never see it destroyed at process exit
+        static StatRegistry* registry = new StatRegistry();
+        return *registry;
+    }
+
+    inline void countStat(StatCounter counter, uint64_t amount = 1) {
+        std::atomic<uint64_t>& value = stats().shard().values[counter];
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    inline void raiseStat(std::atomic<uint64_t>& peak, uint64_t value) {
+        uint64_t current = peak.load(std::memory_order_relaxed);
+        while (current < value && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Times one call into libzstd; record() counts it with the bytes it
+    // consumed and produced. Calls that throw are not counted.
+    class CodecTimer {
+    public:
+        explicit CodecTimer(bool compress)
+            : base_(compress ? STAT_COMPRESS_CALLS : STAT_DECOMPRESS_CALLS),
+              start_(std::chrono::steady_clock::now()) {}
+
+        // Returns the elapsed time in nanoseconds
+        uint64_t record(size_t bytesIn, size_t bytesOut) const {
+            const uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_).count();
+            countStat(base_);
+            countStat(static_cast<StatCounter>(base_ + 1), bytesIn);
+            countStat(static_cast<StatCounter>(base_ + 2), bytesOut);
+            countStat(static_cast<StatCounter>(base_ + 3), nanos);
+            return nanos;
+        }
+
+    private:
+        StatCounter base_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    // Native memory held by contexts, dictionaries and output blocks that have
+    // not been handed to JS yet, checked against a process-wide budget set by
+    // setMemoryBudget(). Growth that would pass the budget throws instead of
+    // allocating; a rejected job fails rather than waits, since the memory it
+    // waits for may be held by the threads it would block.
+    enum MemoryKind {
+        MEMORY_CONTEXTS,
+        MEMORY_DICTIONARIES,
+        MEMORY_BUFFERS,
+        MEMORY_KINDS
+    };
+
+    constexpr const char* MEMORY_KIND_NAMES[] = { "contexts", "dictionaries", "buffers" };
+
+    class MemoryBudget {
+    public:
+        void reserve(MemoryKind kind, uint64_t bytes) {
+            uint64_t current = total.load(std::memory_order_relaxed);
+            for (;;) {
+                const uint64_t cap = limit.load(std::memory_order_relaxed);
+                if (cap != 0 && bytes > cap - std::min(cap, current)) {
+                    rejected.fetch_add(1, std::memory_order_relaxed);
+                    throw std::runtime_error("Memory budget of " + std::to_string(cap) + " bytes exceeded: " +
+                                             std::to_string(bytes) + " more bytes needed for " +
+                                             MEMORY_KIND_NAMES[kind] + " with " +
+                                             std::to_string(current) + " in use");
+                }
+                if (total.compare_exchange_weak(current, current + bytes, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            add(kind, bytes);
+        }
+
+        // Accounts memory that is already allocated, so never fails
+        void force(MemoryKind kind, uint64_t bytes) {
+            total.fetch_add(bytes, std::memory_order_relaxed);
+            add(kind, bytes);
+        }
+
+        void release(MemoryKind kind, uint64_t bytes) {
+            total.fetch_sub(bytes, std::memory_order_relaxed);
+            used[kind].fetch_sub(bytes, std::memory_order_relaxed);
+        }
+
+        // 0 means unlimited
+        std::atomic<uint64_t> limit{0};
+        std::atomic<uint64_t> total{0};
+        std::atomic<uint64_t> peak{0};
+        std::atomic<uint64_t> rejected{0};
+        std::atomic<uint64_t> used[MEMORY_KINDS] = {};
+
+    private:
+        void add(MemoryKind kind, uint64_t bytes) {
+            used[kind].fetch_add(bytes, std::memory_order_relaxed);
+            raiseStat(peak, total.load(std::memory_order_relaxed));
+        }
+    };
+
+    MemoryBudget& memoryBudget() {
+        // Leaked for the same reason as stats()
+        static MemoryBudget* budget = new MemoryBudget();
+        return *budget;
+    }
+
+    inline bool memoryLimited() {
+        return memoryBudget().limit.load(std::memory_order_relaxed) != 0;
+    }
+
+    // Bytes of one kind charged to the budget by their owner and released with it
+    class MemoryCharge {
+    public:
+        explicit MemoryCharge(MemoryKind kind) : kind_(kind) {}
+        MemoryCharge(MemoryCharge&& other) noexcept : kind_(other.kind_), bytes_(other.bytes_) {
+            other.bytes_ = 0;
+        }
+        MemoryCharge& operator=(MemoryCharge&& other) noexcept {
+            if (this != &other) {
+                set(0);
+                kind_ = other.kind_;
+                bytes_ = other.bytes_;
+                other.bytes_ = 0;
+            }
+            return *this;
+        }
+        ~MemoryCharge() { set(0); }
+
+        size_t bytes() const { return bytes_; }
+
+        // Grows the charge to bytes ahead of an allocation; throws if that
+        // would pass the budget. Never shrinks.
+        void reserve(size_t bytes) {
+            if (bytes > bytes_) {
+                memoryBudget().reserve(kind_, bytes - bytes_);
+                bytes_ = bytes;
+            }
+        }
+
+        // Moves the charge to what is actually allocated
+        void set(size_t bytes) {
+            if (bytes > bytes_) {
+                memoryBudget().force(kind_, bytes - bytes_);
+            } else if (bytes < bytes_) {
+                memoryBudget().release(kind_, bytes_ - bytes);
+            }
+            bytes_ = bytes;
+        }
+
+    private:
+        MemoryKind kind_;
+        size_t bytes_ = 0;
+    };
+
+    // Held by every AsyncWorker from construction until it is deleted after
+    // its completion callback
+    class QueueToken {
+    public:
+        QueueToken() {
+            StatRegistry& registry = stats();
+            const int64_t depth = registry.queueDepth.fetch_add(1, std::memory_order_relaxed) + 1;
+            int64_t peak = registry.peakQueueDepth.load(std::memory_order_relaxed);
+            while (peak < depth && !registry.peakQueueDepth.compare_exchange_weak(peak, depth, std::memory_order_relaxed)) {
+            }
+        }
+        ~QueueToken() { stats().queueDepth.fetch_sub(1, std::memory_order_relaxed); }
+        QueueToken(const QueueToken&) = delete;
+        QueueToken& operator=(const QueueToken&) = delete;
+    };
 
     inline int validateLevel(int level) {
-        if (level < MIN_LEVEL || level > MAX_LEVEL) {
+        if (level < ZSTD_minCLevel() || level > ZSTD_maxCLevel()) {
             throw std::runtime_error("Compression level must be between " + 
-                                   std::to_string(MIN_LEVEL) + " and " + 
-                                   std::to_string(MAX_LEVEL));
+                                   std::to_string(ZSTD_minCLevel()) + " and " + 
+                                   std::to_string(ZSTD_maxCLevel()));
         }
         return level;
     }
-    
-    inline void validateSize(size_t size, size_t limit, const std::string& context) {
-        if (size > limit) {
-            throw std::runtime_error(context + " size " + std::to_string(size) + 
-                                    " exceeds maximum allowed size " + 
-                                    std::to_string(limit));
-        }
+    
+    inline void validateSize(size_t size, size_t limit, const std::string& context) {
+        if (size > limit) {
+            throw std::runtime_error(context + " size " + std::to_string(size) + 
+                                    " exceeds maximum allowed size " + 
+                                    std::to_string(limit));
+        }
+    }
+
+    inline size_t safeConvertToSizeT(int64_t value, const std::string& context) {
+        if (value < 0) {
+            throw std::runtime_error(context + " cannot be negative");
+        }
+        if (static_cast<uint64_t>(value) > SIZE_MAX) {
+            throw std::runtime_error(context + " is too large");
+        }
+        return static_cast<size_t>(value);
+    }
+
+    struct CCtxDeleter {
+        void operator()(ZSTD_CCtx* cctx) const { ZSTD_freeCCtx(cctx); }
+    };
+
+    // Decompression contexts are charged their fixed ZSTD_estimateDCtxSize();
+    // buffers for streaming are charged while a stream uses them
+    struct DCtxDeleter {
+        void operator()(ZSTD_DCtx* dctx) const {
+            ZSTD_freeDCtx(dctx);
+            memoryBudget().release(MEMORY_CONTEXTS, ZSTD_estimateDCtxSize());
+        }
+    };
+
+    using CCtxPtr = std::unique_ptr<ZSTD_CCtx, CCtxDeleter>;
+    using DCtxPtr = std::unique_ptr<ZSTD_DCtx, DCtxDeleter>;
+
+    inline CCtxPtr createCCtx() {
+        CCtxPtr cctx(ZSTD_createCCtx());
+        if (!cctx) {
+            throw std::runtime_error("Failed to create compression context");
+        }
+        return cctx;
+    }
+
+    inline DCtxPtr createDCtx() {
+        memoryBudget().reserve(MEMORY_CONTEXTS, ZSTD_estimateDCtxSize());
+        ZSTD_DCtx* dctx = ZSTD_createDCtx();
+        if (!dctx) {
+            memoryBudget().release(MEMORY_CONTEXTS, ZSTD_estimateDCtxSize());
+            throw std::runtime_error("Failed to create decompression context");
+        }
+        return DCtxPtr(dctx);
+    }
+
+    // Largest output block the BlockPool recycles unless configured otherwise
+    constexpr size_t DEFAULT_POOL_BLOCK_SIZE = 4ULL << 20;
+
+    // Threads that run jobs: the libuv threadpool plus the main thread
+    inline size_t defaultArenaSlots() {
+        const char* value = std::getenv("UV_THREADPOOL_SIZE");
+        const long threads = value ? std::strtol(value, nullptr, 10) : 0;
+        return static_cast<size_t>(threads > 0 ? std::min(threads, 1024L) : 4) + 1;
+    }
+
+    // One allocation cut into per-thread slots for the pooled contexts, which
+    // are placed in them with ZSTD_initStaticCCtx/ZSTD_initStaticDCtx, so the
+    // footprint is fixed and libzstd never allocates. Set up once per process
+    // by configureContextArena(); threads that find no slot left keep heap
+    // contexts. Static contexts do not run workers, and fail calls that need
+    // more memory than their slot holds.
+    class ContextArena {
+    public:
+        ContextArena(size_t compressSlotSize, size_t decompressSlotSize, size_t slots)
+            // libzstd wants 8-byte aligned workspaces
+            : compressSlotSize_((compressSlotSize + 63) & ~size_t{63}),
+              decompressSlotSize_((decompressSlotSize + 63) & ~size_t{63}),
+              slots_(slots) {
+            memory_.reserve(slots_ * (compressSlotSize_ + decompressSlotSize_));
+            arena_.reset(static_cast<uint8_t*>(std::malloc(memory_.bytes())));
+            if (!arena_) {
+                throw std::runtime_error("Failed to allocate a " + std::to_string(memory_.bytes()) +
+                                         " byte context arena");
+            }
+        }
+
+        size_t compressSlotSize() const { return compressSlotSize_; }
+        size_t decompressSlotSize() const { return decompressSlotSize_; }
+        size_t slots() const { return slots_; }
+        size_t bytes() const { return memory_.bytes(); }
+
+        // The next free slot, or nullptr once all are taken
+        uint8_t* takeCompress() {
+            const size_t slot = nextCompress_.fetch_add(1, std::memory_order_relaxed);
+            return slot < slots_ ? arena_.get() + slot * compressSlotSize_ : nullptr;
+        }
+
+        uint8_t* takeDecompress() {
+            const size_t slot = nextDecompress_.fetch_add(1, std::memory_order_relaxed);
+            return slot < slots_ ? arena_.get() + slots_ * compressSlotSize_ + slot * decompressSlotSize_ : nullptr;
+        }
+
+        bool compressFull() const { return nextCompress_.load(std::memory_order_relaxed) >= slots_; }
+        bool decompressFull() const { return nextDecompress_.load(std::memory_order_relaxed) >= slots_; }
+
+    private:
+        struct FreeDeleter {
+            void operator()(uint8_t* p) const { std::free(p); }
+        };
+
+        const size_t compressSlotSize_;
+        const size_t decompressSlotSize_;
+        const size_t slots_;
+        MemoryCharge memory_{ MEMORY_CONTEXTS };
+        std::unique_ptr<uint8_t, FreeDeleter> arena_;
+        std::atomic<size_t> nextCompress_{0};
+        std::atomic<size_t> nextDecompress_{0};
+    };
+
+    // Never freed once set, since slots stay in use by their threads
+    std::atomic<ContextArena*> g_contextArena{nullptr};
+
+    inline ContextArena* contextArena() {
+        return g_contextArena.load(std::memory_order_acquire);
+    }
+
+    // Compression contexts are pooled per thread by threadCCtx() below. The
+    // libuv threadpool is shared by every environment in the process, so
+    // worker_threads draw on the same warm contexts rather than each
+    // allocating their own. Once an arena is configured, a thread moves to a
+    // static context in its slot on its next call.
+    ZSTD_DCtx* threadDCtx() {
+        thread_local DCtxPtr dctx;
+        thread_local ZSTD_DCtx* fixed = nullptr;
+        if (!fixed) {
+            ContextArena* arena = contextArena();
+            if (arena && !arena->decompressFull()) {
+                if (uint8_t* slot = arena->takeDecompress()) {
+                    fixed = ZSTD_initStaticDCtx(slot, arena->decompressSlotSize());
+                    dctx.reset();
+                    countStat(STAT_DCTX_MISSES);
+                    return fixed;
+                }
+            }
+        }
+        if (fixed) {
+            countStat(STAT_DCTX_HITS);
+            return fixed;
+        }
+        if (!dctx) {
+            dctx = createDCtx();
+            countStat(STAT_DCTX_MISSES);
+        } else {
+            countStat(STAT_DCTX_HITS);
+        }
+        return dctx.get();
+    }
+
+    struct CDictDeleter {
+        void operator()(ZSTD_CDict* cdict) const { ZSTD_freeCDict(cdict); }
+    };
+
+    struct DDictDeleter {
+        void operator()(ZSTD_DDict* ddict) const { ZSTD_freeDDict(ddict); }
+    };
+
+    using CDictPtr = std::unique_ptr<ZSTD_CDict, CDictDeleter>;
+    using DDictPtr = std::unique_ptr<ZSTD_DDict, DDictDeleter>;
+
+    // A dictionary digested once into ZSTD_CDict/ZSTD_DDict form. Digested
+    // dictionaries are read-only, so one instance is shared by every job that
+    // uses it, on any thread, through shared_ptr.
+    class DictionaryData {
+    public:
+        DictionaryData(const uint8_t* data, size_t size, int level)
+            : content_(data, data + size),
+              level_(level),
+              cdict_(createCDict(level)),
+              ddict_(ZSTD_createDDict(content_.data(), content_.size())),
+              id_(ZSTD_getDictID_fromDict(content_.data(), content_.size())) {
+            if (!ddict_) {
+                throw std::runtime_error("Failed to load dictionary");
+            }
+            memory_.reserve(content_.size() + ZSTD_sizeof_CDict(cdict_.get()) + ZSTD_sizeof_DDict(ddict_.get()));
+        }
+
+        int level() const { return level_; }
+        bool matches(const uint8_t* data, size_t size) const {
+            return size == content_.size() && std::memcmp(data, content_.data(), size) == 0;
+        }
+        unsigned id() const { return id_; }
+        size_t size() const { return content_.size(); }
+        const ZSTD_DDict* ddict() const { return ddict_.get(); }
+
+        // CDicts bake in the compression level; other levels are digested on
+        // first use and cached.
+        const ZSTD_CDict* cdict(int level) const {
+            if (level == level_) {
+                return cdict_.get();
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = cdicts_.find(level);
+            if (it == cdicts_.end()) {
+                CDictPtr cdict = createCDict(level);
+                memory_.reserve(memory_.bytes() + ZSTD_sizeof_CDict(cdict.get()));
+                it = cdicts_.emplace(level, std::move(cdict)).first;
+            }
+            return it->second.get();
+        }
+
+        // Whether cdict(level) returns without digesting anything
+        bool hasCDict(int level) const {
+            if (level == level_) {
+                return true;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            return cdicts_.count(level) != 0;
+        }
+
+    private:
+        CDictPtr createCDict(int level) const {
+            CDictPtr cdict(ZSTD_createCDict(content_.data(), content_.size(), level));
+            if (!cdict) {
+                throw std::runtime_error("Failed to load dictionary");
+            }
+            return cdict;
+        }
+
+        const std::vector<uint8_t> content_;
+        const int level_;
+        const CDictPtr cdict_;
+        const DDictPtr ddict_;
+        const unsigned id_;
+        mutable std::mutex mutex_;
+        mutable std::map<int, CDictPtr> cdicts_;
+        mutable MemoryCharge memory_{ MEMORY_DICTIONARIES };
+    };
+
+    using DictionaryPtr = std::shared_ptr<const DictionaryData>;
+
+    // Process-wide cache of digested dictionaries, keyed by content and level,
+    // so every environment that loads the same dictionary (e.g. each of a pool
+    // of worker_threads) shares one DictionaryData. Entries are weak, and a
+    // dictionary is freed once no environment references it.
+    DictionaryPtr loadDictionary(const uint8_t* data, size_t size, int level) {
+        using Key = std::tuple<size_t, size_t, int>;
+        static std::mutex mutex;
+        static std::map<Key, std::weak_ptr<const DictionaryData>> cache;
+
+        const Key key(std::hash<std::string_view>()(
+            std::string_view(reinterpret_cast<const char*>(data), size)), size, level);
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(key);
+        if (it != cache.end()) {
+            if (DictionaryPtr cached = it->second.lock()) {
+                // A hash collision just goes uncached
+                return cached->matches(data, size) ?
+                    cached : std::make_shared<const DictionaryData>(data, size, level);
+            }
+        }
+
+        for (auto entry = cache.begin(); entry != cache.end();) {
+            entry = entry->second.expired() ? cache.erase(entry) : std::next(entry);
+        }
+        auto loaded = std::make_shared<const DictionaryData>(data, size, level);
+        cache[key] = loaded;
+        return loaded;
+    }
+
+    // Distinguishes Dictionary objects from other wrapped objects on unwrap
+    constexpr napi_type_tag DICTIONARY_TYPE_TAG = { 0x7a737464f1c3a001ULL, 0x9b2e6d4c8a15f302ULL };
+
+    // Recycles output blocks when configureBufferPool() enables it, so steady
+    // state does not allocate. Blocks come in power-of-two classes up to the
+    // largest pooled size and carry a header naming their class, which lets a
+    // Buffer finalizer return them from any environment. Idle blocks are kept
+    // up to maxIdleBytes and charged to the buffers budget.
+    class BlockPool {
+    public:
+        static constexpr int MIN_CLASS = 12;
+        static constexpr int MAX_CLASS = 30;
+        // Keeps the data after the header malloc-aligned
+        static constexpr size_t HEADER_SIZE = 16;
+
+        // Size of the block that would hold capacity bytes, or 0 if such
+        // blocks are not pooled
+        size_t blockSize(size_t capacity) const {
+            const size_t largest = maxBlock_.load(std::memory_order_relaxed);
+            return capacity == 0 || capacity > largest ? 0 : size_t{1} << classFor(capacity);
+        }
+
+        // A block of blockSize(capacity) bytes, recycled if one is idle, or
+        // nullptr if the size is not pooled. Throws if malloc fails.
+        uint8_t* take(size_t capacity) {
+            const size_t size = blockSize(capacity);
+            if (size == 0) {
+                return nullptr;
+            }
+            const int cls = classFor(capacity);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                std::vector<uint8_t*>& blocks = idle_[cls - MIN_CLASS];
+                if (!blocks.empty()) {
+                    uint8_t* data = blocks.back();
+                    blocks.pop_back();
+                    idleBytes_ -= size;
+                    idleCharge_.set(idleBytes_);
+                    hits.fetch_add(1, std::memory_order_relaxed);
+                    return data;
+                }
+            }
+            misses.fetch_add(1, std::memory_order_relaxed);
+            auto* block = static_cast<uint8_t*>(std::malloc(HEADER_SIZE + size));
+            if (!block) {
+                throw std::runtime_error("Failed to allocate " + std::to_string(size) + " byte output buffer");
+            }
+            block[0] = static_cast<uint8_t>(cls);
+            return block + HEADER_SIZE;
+        }
+
+        // Returns a block from take(); it is freed if the pool is full or off
+        void give(uint8_t* data) {
+            uint8_t* block = data - HEADER_SIZE;
+            const int cls = block[0];
+            const size_t size = size_t{1} << cls;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (size <= maxBlock_.load(std::memory_order_relaxed) && idleBytes_ + size <= maxIdle_) {
+                    idle_[cls - MIN_CLASS].push_back(data);
+                    idleBytes_ += size;
+                    idleCharge_.set(idleBytes_);
+                    return;
+                }
+            }
+            std::free(block);
+        }
+
+        // maxIdle 0 turns pooling off and frees every idle block
+        void configure(size_t maxIdle, size_t maxBlock) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            maxIdle_ = maxIdle;
+            maxBlock_.store(maxIdle == 0 ? 0 : std::min(maxBlock, size_t{1} << MAX_CLASS),
+                            std::memory_order_relaxed);
+            for (int cls = MAX_CLASS; cls >= MIN_CLASS; cls--) {
+                std::vector<uint8_t*>& blocks = idle_[cls - MIN_CLASS];
+                while (!blocks.empty() && (idleBytes_ > maxIdle_ || (size_t{1} << cls) > maxBlock_)) {
+                    std::free(blocks.back() - HEADER_SIZE);
+                    blocks.pop_back();
+                    idleBytes_ -= size_t{1} << cls;
+                }
+            }
+            idleCharge_.set(idleBytes_);
+        }
+
+        size_t idleBytes() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return idleBytes_;
+        }
+
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+
+    private:
+        static int classFor(size_t capacity) {
+            int cls = MIN_CLASS;
+            while ((size_t{1} << cls) < capacity) {
+                cls++;
+            }
+            return cls;
+        }
+
+        std::mutex mutex_;
+        std::vector<uint8_t*> idle_[MAX_CLASS - MIN_CLASS + 1];
+        size_t idleBytes_ = 0;
+        size_t maxIdle_ = 0;
+        std::atomic<size_t> maxBlock_{0};
+        MemoryCharge idleCharge_{ MEMORY_BUFFERS };
+    };
+
+    BlockPool& blockPool() {
+        // Leaked: finalizers of Buffers that outlive the addon still return blocks
+        static BlockPool* pool = new BlockPool();
+        return *pool;
+    }
+
+    // Frees an output block, or returns it to the pool it came from
+    struct BlockDeleter {
+        bool pooled = false;
+        void operator()(uint8_t* p) const {
+            if (pooled) {
+                blockPool().give(p);
+            } else {
+                std::free(p);
+            }
+        }
+    };
+
+    // Output block whose ownership is handed to a JS Buffer without a copy:
+    // malloc'd, or from the BlockPool when it pools the size. Memory is left
+    // uninitialized; size() tracks how much was written.
+    class OutputBuffer {
+    public:
+        OutputBuffer() = default;
+
+        explicit OutputBuffer(size_t capacity) : capacity_(capacity) {
+            allocate(capacity);
+            raiseStat(stats().peakOutputAllocation, capacity);
+        }
+
+        uint8_t* data() const { return data_.get(); }
+        size_t size() const { return size_; }
+        size_t capacity() const { return capacity_; }
+        void setSize(size_t size) { size_ = size; }
+
+        // Returns the unused tail to the allocator. For compression the block
+        // is sized by ZSTD_compressBound, which is far larger than typical
+        // output. A pooled block moves to the smallest class that holds it.
+        void shrinkToFit() {
+            if (size_ == capacity_ || size_ == 0) {
+                return;
+            }
+            if (data_.get_deleter().pooled) {
+                if (blockPool().blockSize(size_) < memory_.bytes()) {
+                    OutputBuffer smaller(size_);
+                    std::memcpy(smaller.data(), data(), size_);
+                    smaller.setSize(size_);
+                    *this = std::move(smaller);
+                }
+                return;
+            }
+            if (void* shrunk = std::realloc(data_.get(), size_)) {
+                data_.release();
+                data_.reset(static_cast<uint8_t*>(shrunk));
+                capacity_ = size_;
+                memory_.set(capacity_);
+            }
+        }
+
+        // Enlarges the block, keeping the bytes written so far. The new
+        // capacity may be below the current one but never below size().
+        void grow(size_t capacity) {
+            if (capacity < size_) {
+                throw std::runtime_error("Output buffer cannot shrink below its " +
+                                         std::to_string(size_) + " written bytes");
+            }
+            if (data_.get_deleter().pooled || blockPool().blockSize(capacity) != 0) {
+                // Room left in the block's class needs no copy
+                if (data_.get_deleter().pooled && capacity <= memory_.bytes()) {
+                    capacity_ = capacity;
+                    return;
+                }
+                OutputBuffer larger(capacity);
+                if (size_) {
+                    std::memcpy(larger.data(), data(), size_);
+                }
+                larger.setSize(size_);
+                *this = std::move(larger);
+                return;
+            }
+            memory_.reserve(capacity);
+            void* grown = std::realloc(data_.get(), capacity);
+            if (!grown) {
+                memory_.set(capacity_);
+                throw std::runtime_error("Failed to allocate " + std::to_string(capacity) +
+                                         " byte output buffer");
+            }
+            data_.release();
+            data_.reset(static_cast<uint8_t*>(grown));
+            capacity_ = capacity;
+            raiseStat(stats().peakOutputAllocation, capacity);
+        }
+
+        // Transfers ownership to a Buffer; freed (or returned to the pool) by
+        // its finalizer when collected.
+        Napi::Buffer<uint8_t> toBuffer(Napi::Env env) {
+            if (size_ == 0) {
+                return Napi::Buffer<uint8_t>::New(env, 0);
+            }
+            const bool pooled = data_.get_deleter().pooled;
+            uint8_t* data = data_.release();
+            const size_t size = size_;
+            capacity_ = size_ = 0;
+            memory_.set(0);
+            if (pooled) {
+                return Napi::Buffer<uint8_t>::NewOrCopy(env, data, size,
+                    [](Napi::Env, uint8_t* finalizeData) { blockPool().give(finalizeData); });
+            }
+            return Napi::Buffer<uint8_t>::NewOrCopy(env, data, size,
+                [](Napi::Env, uint8_t* finalizeData) { std::free(finalizeData); });
+        }
+
+    private:
+        void allocate(size_t capacity) {
+            if (uint8_t* block = blockPool().take(capacity)) {
+                data_ = std::unique_ptr<uint8_t, BlockDeleter>(block, BlockDeleter{ true });
+                memory_.reserve(blockPool().blockSize(capacity));
+                return;
+            }
+            memory_.reserve(capacity);
+            data_.reset(capacity ? static_cast<uint8_t*>(std::malloc(capacity)) : nullptr);
+            if (capacity && !data_) {
+                throw std::runtime_error("Failed to allocate " + std::to_string(capacity) +
+                                         " byte output buffer");
+            }
+        }
+
+        std::unique_ptr<uint8_t, BlockDeleter> data_;
+        size_t capacity_ = 0;
+        size_t size_ = 0;
+        // Until ownership passes to JS
+        MemoryCharge memory_{ MEMORY_BUFFERS };
+    };
+
+    // Byte range inside a Buffer/TypedArray/DataView/ArrayBuffer
+    struct ByteSpan {
+        uint8_t* data;
+        size_t size;
+    };
+
+    // A bare SharedArrayBuffer cannot be read through N-API, whose
+    // napi_get_arraybuffer_info rejects shared buffers, so it is wrapped in a
+    // Uint8Array; views of one need nothing, their data pointer is read
+    // from the view itself.
+    inline Napi::Value asByteView(const Napi::Value& value) {
+        if (!value.IsObject() || value.IsTypedArray() || value.IsDataView() || value.IsArrayBuffer()) {
+            return value;
+        }
+        Napi::Env env = value.Env();
+        const Napi::Value shared = env.Global().Get("SharedArrayBuffer");
+        if (shared.IsFunction() && value.As<Napi::Object>().InstanceOf(shared.As<Napi::Function>())) {
+            return env.Global().Get("Uint8Array").As<Napi::Function>().New({ value });
+        }
+        return value;
+    }
+
+    // Resolves the bytes of any ArrayBufferView or ArrayBuffer; returns false
+    // for anything else
+    inline bool getByteSpan(const Napi::Value& value, ByteSpan& span) {
+        if (value.IsTypedArray()) {
+            void* data = nullptr;
+            if (napi_get_typedarray_info(value.Env(), value, nullptr, nullptr, &data, nullptr, nullptr) != napi_ok) {
+                throw std::runtime_error("Cannot read TypedArray");
+            }
+            span = { static_cast<uint8_t*>(data), value.As<Napi::TypedArray>().ByteLength() };
+            return true;
+        }
+        if (value.IsDataView()) {
+            auto view = value.As<Napi::DataView>();
+            span = { static_cast<uint8_t*>(view.Data()), view.ByteLength() };
+            return true;
+        }
+        if (value.IsArrayBuffer()) {
+            auto buffer = value.As<Napi::ArrayBuffer>();
+            span = { static_cast<uint8_t*>(buffer.Data()), buffer.ByteLength() };
+            return true;
+        }
+        return false;
+    }
+
+    // Input bytes plus the JS object that owns them, which asynchronous jobs
+    // keep referenced until they complete
+    struct InputBytes {
+        Napi::Object object;
+        ByteSpan span;
+
+        const uint8_t* Data() const { return span.data; }
+        size_t Length() const { return span.size; }
+    };
+
+    inline InputBytes getInputBytes(const Napi::Value& value, const std::string& name) {
+        const Napi::Value view = asByteView(value);
+        ByteSpan span;
+        if (!getByteSpan(view, span)) {
+            throw std::runtime_error(name + " must be a Buffer, TypedArray, DataView or ArrayBuffer");
+        }
+        return { view.As<Napi::Object>(), span };
+    }
+
+    inline InputBytes getInputBuffer(const Napi::CallbackInfo& info) {
+        return getInputBytes(info.Length() > 0 ? info[0] : info.Env().Undefined(), "First argument");
+    }
+
+    inline int getLevel(const Napi::CallbackInfo& info, size_t index) {
+        return info.Length() > index && info[index].IsNumber() ?
+            validateLevel(info[index].As<Napi::Number>().Int32Value()) :
+            DEFAULT_LEVEL;
+    }
+
+    // Reads an optional non-negative integer property, checked against max
+    inline unsigned getUnsignedOption(const Napi::Object& object, const char* name,
+                                      unsigned fallback, unsigned max) {
+        const Napi::Value value = object.Get(name);
+        if (value.IsUndefined()) {
+            return fallback;
+        }
+        const int64_t number = value.IsNumber() ? value.As<Napi::Number>().Int64Value() : -1;
+        if (number < 0 || static_cast<uint64_t>(number) > max) {
+            throw std::runtime_error(std::string("Option ") + name + " must be an integer between 0 and " +
+                                     std::to_string(max));
+        }
+        return static_cast<unsigned>(number);
+    }
+
+    inline bool getBooleanOption(const Napi::Object& object, const char* name) {
+        const Napi::Value value = object.Get(name);
+        if (value.IsUndefined()) {
+            return false;
+        }
+        if (!value.IsBoolean()) {
+            throw std::runtime_error(std::string("Option ") + name + " must be a boolean");
+        }
+        return value.As<Napi::Boolean>().Value();
+    }
+
+    DictionaryPtr getDictionary(const Napi::Value& value);
+
+    inline std::optional<size_t> getSizeOption(const Napi::Object& object, const char* name) {
+        const Napi::Value value = object.Get(name);
+        if (value.IsUndefined()) {
+            return std::nullopt;
+        }
+        if (!value.IsNumber()) {
+            throw std::runtime_error(std::string("Option ") + name + " must be a number");
+        }
+        return safeConvertToSizeT(value.As<Napi::Number>().Int64Value(), std::string("Option ") + name);
+    }
+
+    // Reads { maxInputSize, maxOutputSize } from an options object, if any
+    LimitOverrides getLimitOverrides(const Napi::CallbackInfo& info, size_t index) {
+        LimitOverrides overrides;
+        if (info.Length() > index && info[index].IsObject()) {
+            auto object = info[index].As<Napi::Object>();
+            overrides.maxInput = getSizeOption(object, "maxInputSize");
+            overrides.maxOutput = getSizeOption(object, "maxOutputSize");
+        }
+        return overrides;
+    }
+
+    // Inputs per worker when { workers: 'auto' } sizes the pool; below two
+    // jobs' worth of input, multithreading only adds overhead.
+    constexpr size_t AUTO_WORKER_INPUT_SIZE = 8ULL << 20;
+
+    // Upper bound for ZSTD_c_nbWorkers; 0 when libzstd was built without
+    // ZSTD_MULTITHREAD, in which case worker requests fall back to inline
+    // single-threaded compression.
+    inline int maxWorkers() {
+        static const int max = [] {
+            const ZSTD_bounds bounds = ZSTD_cParam_getBounds(ZSTD_c_nbWorkers);
+            return ZSTD_isError(bounds.error) ? 0 : bounds.upperBound;
+        }();
+        return max;
+    }
+
+    using ParameterList = std::vector<std::pair<ZSTD_cParameter, int>>;
+
+    // Advanced parameters accepted in the options object, named after their
+    // ZSTD_c_* counterparts. Values are checked with ZSTD_cParam_getBounds.
+    struct CompressParameterName {
+        const char* name;
+        ZSTD_cParameter param;
+    };
+
+    constexpr CompressParameterName COMPRESS_PARAMETERS[] = {
+        { "windowLog", ZSTD_c_windowLog },
+        { "hashLog", ZSTD_c_hashLog },
+        { "chainLog", ZSTD_c_chainLog },
+        { "searchLog", ZSTD_c_searchLog },
+        { "minMatch", ZSTD_c_minMatch },
+        { "targetLength", ZSTD_c_targetLength },
+        { "strategy", ZSTD_c_strategy },
+        { "targetCBlockSize", ZSTD_c_targetCBlockSize },
+        { "enableLongDistanceMatching", ZSTD_c_enableLongDistanceMatching },
+        { "ldmHashLog", ZSTD_c_ldmHashLog },
+        { "ldmMinMatch", ZSTD_c_ldmMinMatch },
+        { "ldmBucketSizeLog", ZSTD_c_ldmBucketSizeLog },
+        { "ldmHashRateLog", ZSTD_c_ldmHashRateLog },
+        { "contentSizeFlag", ZSTD_c_contentSizeFlag },
+        { "checksumFlag", ZSTD_c_checksumFlag },
+        { "dictIDFlag", ZSTD_c_dictIDFlag },
+        { "jobSize", ZSTD_c_jobSize },
+        { "overlapLog", ZSTD_c_overlapLog }
+    };
+
+    // Index is the ZSTD_strategy value
+    constexpr const char* STRATEGY_NAMES[] = {
+        nullptr, "fast", "dfast", "greedy", "lazy", "lazy2", "btlazy2", "btopt", "btultra", "btultra2"
+    };
+
+    int getParameterValue(const Napi::Value& value, const CompressParameterName& entry) {
+        int number;
+        if (value.IsBoolean()) {
+            number = value.As<Napi::Boolean>().Value() ? 1 : 0;
+        } else if (value.IsNumber()) {
+            number = value.As<Napi::Number>().Int32Value();
+            if (static_cast<double>(number) != value.As<Napi::Number>().DoubleValue()) {
+                throw std::runtime_error(std::string("Option ") + entry.name + " must be an integer");
+            }
+        } else if (value.IsString() && entry.param == ZSTD_c_strategy) {
+            const std::string name = value.As<Napi::String>().Utf8Value();
+            number = 0;
+            for (int i = ZSTD_fast; i <= ZSTD_btultra2; i++) {
+                if (name == STRATEGY_NAMES[i]) {
+                    number = i;
+                }
+            }
+            if (number == 0) {
+                throw std::runtime_error("Unknown strategy '" + name + "'");
+            }
+        } else {
+            throw std::runtime_error(std::string("Option ") + entry.name + " must be a number");
+        }
+
+        const ZSTD_bounds bounds = ZSTD_cParam_getBounds(entry.param);
+        if (ZSTD_isError(bounds.error)) {
+            throw std::runtime_error(std::string("Option ") + entry.name +
+                                     " is not supported by this libzstd");
+        }
+        // 0 selects the library default for every parameter
+        if (number != 0 && (number < bounds.lowerBound || number > bounds.upperBound)) {
+            throw std::runtime_error(std::string("Option ") + entry.name + " must be between " +
+                                     std::to_string(bounds.lowerBound) + " and " +
+                                     std::to_string(bounds.upperBound));
+        }
+        return number;
+    }
+
+    // Input observed between two level changes, or samples if those come
+    // first; keeps the level from reacting to a single outlier
+    constexpr uint64_t ADAPT_WINDOW_BYTES = 1ULL << 20;
+    constexpr unsigned ADAPT_WINDOW_SAMPLES = 32;
+    // Weight of the newest sample in the moving averages
+    constexpr double ADAPT_SMOOTHING = 0.25;
+    // Factor by which a target must be beaten before the level goes up
+    constexpr double ADAPT_HEADROOM = 1.5;
+    constexpr int DEFAULT_ADAPT_MIN_LEVEL = -7;
+    constexpr int DEFAULT_ADAPT_MAX_LEVEL = 19;
+
+    // Level controller for { adapt: { ... } }, in the spirit of zstd --adapt.
+    // Completed compression calls and stream steps report their input size
+    // and the time spent in libzstd; once a window of them is in, the level
+    // steps down if the moving per-byte cost or per-call latency misses a
+    // target and up if every target is beaten by ADAPT_HEADROOM. One
+    // controller is shared by all calls of a Compressor, stream or batch,
+    // from any thread.
+    class AdaptiveLevel {
+    public:
+        AdaptiveLevel(int start, int minLevel, int maxLevel, double targetThroughput, double maxLatency)
+            : level_(std::clamp(start, minLevel, maxLevel)),
+              minLevel_(minLevel),
+              maxLevel_(maxLevel),
+              targetThroughput_(targetThroughput),
+              maxLatency_(maxLatency) {}
+
+        int level() const { return level_.load(std::memory_order_relaxed); }
+
+        void observe(size_t bytes, uint64_t nanos) {
+            if (bytes == 0) {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            const double cost = static_cast<double>(nanos) / bytes;
+            const double weight = samples_ == 0 ? 1.0 : ADAPT_SMOOTHING;
+            cost_ += (cost - cost_) * weight;
+            latency_ += (static_cast<double>(nanos) - latency_) * weight;
+            samples_++;
+            windowBytes_ += bytes;
+            if (windowBytes_ < ADAPT_WINDOW_BYTES && samples_ < ADAPT_WINDOW_SAMPLES) {
+                return;
+            }
+
+            // bytes per nanosecond * 1000 = MB/s
+            const double throughput = 1000.0 / std::max(cost_, 1e-9);
+            const bool slow = (targetThroughput_ > 0 && throughput < targetThroughput_) ||
+                              (maxLatency_ > 0 && latency_ > maxLatency_);
+            const bool fast = (targetThroughput_ <= 0 || throughput > targetThroughput_ * ADAPT_HEADROOM) &&
+                              (maxLatency_ <= 0 || latency_ * ADAPT_HEADROOM < maxLatency_);
+            int level = level_.load(std::memory_order_relaxed);
+            if (slow && level > minLevel_) {
+                level--;
+            } else if (fast && !slow && level < maxLevel_) {
+                level++;
+            } else {
+                return;
+            }
+            // Level 0 stands for the default level, not a step between 1 and -1
+            if (level == 0) {
+                level = slow ? std::max(-1, minLevel_) : std::min(1, maxLevel_);
+            }
+            level_.store(level, std::memory_order_relaxed);
+            samples_ = 0;
+            windowBytes_ = 0;
+        }
+
+    private:
+        std::mutex mutex_;
+        std::atomic<int> level_;
+        const int minLevel_;
+        const int maxLevel_;
+        const double targetThroughput_; // MB/s, 0 when unset
+        const double maxLatency_;       // ns, 0 when unset
+        double cost_ = 0;               // ns per input byte
+        double latency_ = 0;            // ns per call
+        unsigned samples_ = 0;
+        uint64_t windowBytes_ = 0;
+    };
+
+    // Input fed to ZSTD_compressStream2 per step, and output produced by
+    // ZSTD_decompressStream per step, by calls that can be cancelled
+    constexpr size_t CANCEL_COMPRESS_STEP = ZSTD_BLOCKSIZE_MAX;
+    constexpr size_t CANCEL_DECOMPRESS_STEP = 1 << 20;
+
+    // Cancellation of one call by an AbortSignal and/or a deadline ({ signal,
+    // deadlineMs }). The codec polls check() between steps and throws from
+    // there, which frees the partial output and hands the context back at
+    // once; the deadline counts from the call, so time spent queued counts.
+    class Cancellation : public std::enable_shared_from_this<Cancellation> {
+    public:
+        enum Reason { NONE, ABORTED, EXPIRED };
+
+        // Any thread
+        void abort() {
+            aborted_.store(true, std::memory_order_relaxed);
+        }
+
+        void check() {
+            if (aborted_.load(std::memory_order_relaxed)) {
+                fired_.store(ABORTED, std::memory_order_relaxed);
+                throw std::runtime_error("The operation was aborted");
+            }
+            if (deadline_ && std::chrono::steady_clock::now() >= *deadline_) {
+                fired_.store(EXPIRED, std::memory_order_relaxed);
+                const bool whole = std::floor(deadlineMs_) == deadlineMs_ && deadlineMs_ < 1e15;
+                throw std::runtime_error("Deadline of " + (whole ? std::to_string(static_cast<long long>(deadlineMs_)) :
+                                                           std::to_string(deadlineMs_)) + " ms exceeded");
+            }
+        }
+
+        // Main thread. Null when the options set neither a signal nor a deadline.
+        static std::shared_ptr<Cancellation> fromOptions(const Napi::Value& value) {
+            if (!value.IsObject()) {
+                return nullptr;
+            }
+            auto object = value.As<Napi::Object>();
+            const Napi::Value signal = object.Get("signal");
+            const Napi::Value deadline = object.Get("deadlineMs");
+            if (signal.IsUndefined() && deadline.IsUndefined()) {
+                return nullptr;
+            }
+
+            auto cancellation = std::make_shared<Cancellation>();
+            if (!deadline.IsUndefined()) {
+                const double ms = deadline.IsNumber() ? deadline.As<Napi::Number>().DoubleValue() : -1;
+                if (!(ms >= 0) || !std::isfinite(ms)) {
+                    throw std::runtime_error("Option deadlineMs must be a non-negative number");
+                }
+                cancellation->deadlineMs_ = ms;
+                cancellation->deadline_ = std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double, std::milli>(ms));
+            }
+            if (!signal.IsUndefined()) {
+                if (!signal.IsObject() || !signal.As<Napi::Object>().Get("addEventListener").IsFunction()) {
+                    throw std::runtime_error("Option signal must be an AbortSignal");
+                }
+                auto object = signal.As<Napi::Object>();
+                if (object.Get("aborted").ToBoolean()) {
+                    cancellation->abort();
+                }
+                cancellation->signal_ = Napi::Persistent(object);
+            }
+            return cancellation;
+        }
+
+        // Main thread: follows the signal until release(). Synchronous calls
+        // skip this, as the signal cannot fire while they run.
+        void listen(Napi::Env env) {
+            if (signal_.IsEmpty() || aborted_.load(std::memory_order_relaxed)) {
+                return;
+            }
+            std::weak_ptr<Cancellation> self = shared_from_this();
+            auto listener = Napi::Function::New(env, [self](const Napi::CallbackInfo&) {
+                if (auto cancellation = self.lock()) {
+                    cancellation->abort();
+                }
+            });
+            signal_.Value().Get("addEventListener").As<Napi::Function>().Call(
+                signal_.Value(), { Napi::String::New(env, "abort"), listener });
+            listener_ = Napi::Persistent(listener);
+        }
+
+        // Main thread, once the call has settled: a long-lived signal must
+        // not keep a listener per call
+        void release() {
+            if (!listener_.IsEmpty()) {
+                Napi::Env env = listener_.Env();
+                signal_.Value().Get("removeEventListener").As<Napi::Function>().Call(
+                    signal_.Value(), { Napi::String::New(env, "abort"), listener_.Value() });
+                listener_.Reset();
+            }
+            signal_.Reset();
+        }
+
+        // Main thread: names an error check() raised AbortError (with the
+        // signal's reason as its cause) or TimeoutError
+        Napi::Error decorate(Napi::Error error) const {
+            const Reason reason = fired_.load(std::memory_order_relaxed);
+            if (reason == ABORTED) {
+                error.Set("name", Napi::String::New(error.Env(), "AbortError"));
+                error.Set("code", Napi::String::New(error.Env(), "ABORT_ERR"));
+                if (!signal_.IsEmpty()) {
+                    error.Set("cause", signal_.Value().Get("reason"));
+                }
+            } else if (reason == EXPIRED) {
+                error.Set("name", Napi::String::New(error.Env(), "TimeoutError"));
+                error.Set("code", Napi::String::New(error.Env(), "ETIMEDOUT"));
+            }
+            return error;
+        }
+
+    private:
+        std::atomic<bool> aborted_{false};
+        std::atomic<Reason> fired_{NONE};
+        std::optional<std::chrono::steady_clock::time_point> deadline_;
+        double deadlineMs_ = 0;
+        Napi::ObjectReference signal_;
+        Napi::FunctionReference listener_;
+    };
+    using CancellationPtr = std::shared_ptr<Cancellation>;
+
+    // Polled between codec steps; free when the call cannot be cancelled
+    inline void checkCancelled(const CancellationPtr& cancel) {
+        if (cancel) {
+            cancel->check();
+        }
+    }
+
+    // The error to reject or throw for a failed call, named by decorate()
+    // when the call was cancelled
+    inline Napi::Error callError(Napi::Env env, const std::string& message, const CancellationPtr& cancel) {
+        Napi::Error error = Napi::Error::New(env, message);
+        return cancel ? cancel->decorate(error) : error;
+    }
+
+    // Digest of the output computed as it is produced ({ digest }), so callers
+    // need no second pass over it. Both are reported big-endian in hex, the
+    // form xxhsum and crc32c tools print.
+    enum DigestKind {
+        DIGEST_NONE,
+        DIGEST_XXH64,
+        DIGEST_CRC32C
+    };
+
+    // Output produced per step by the decoders when a digest is requested,
+    // so each piece is hashed while it is still in cache
+    constexpr size_t DIGEST_STEP = ZSTD_BLOCKSIZE_MAX;
+
+    // CRC32C (Castagnoli, as used by iSCSI, ext4 and cloud object stores),
+    // with the SSE4.2 or ARMv8 CRC instructions where the CPU has them
+    namespace crc32c {
+        constexpr uint32_t POLY = 0x82F63B78; // reflected
+
+        inline const uint32_t* table() {
+            static const auto* entries = [] {
+                auto* t = new uint32_t[256];
+                for (uint32_t i = 0; i < 256; i++) {
+                    uint32_t crc = i;
+                    for (int bit = 0; bit < 8; bit++) {
+                        crc = (crc >> 1) ^ (POLY & (0 - (crc & 1)));
+                    }
+                    t[i] = crc;
+                }
+                return t;
+            }();
+            return entries;
+        }
+
+        inline uint32_t software(uint32_t crc, const uint8_t* data, size_t size) {
+            const uint32_t* t = table();
+            for (size_t i = 0; i < size; i++) {
+                crc = t[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+            }
+            return crc;
+        }
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+        __attribute__((target("sse4.2")))
+        inline uint32_t hardware(uint32_t crc, const uint8_t* data, size_t size) {
+            uint64_t value = crc;
+            for (; size >= 8; data += 8, size -= 8) {
+                uint64_t word;
+                std::memcpy(&word, data, 8);
+                value = _mm_crc32_u64(value, word);
+            }
+            crc = static_cast<uint32_t>(value);
+            for (; size > 0; data++, size--) {
+                crc = _mm_crc32_u8(crc, *data);
+            }
+            return crc;
+        }
+
+        inline bool hasHardware() {
+            static const bool supported = __builtin_cpu_supports("sse4.2");
+            return supported;
+        }
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+        inline uint32_t hardware(uint32_t crc, const uint8_t* data, size_t size) {
+            for (; size >= 8; data += 8, size -= 8) {
+                uint64_t word;
+                std::memcpy(&word, data, 8);
+                crc = __crc32cd(crc, word);
+            }
+            for (; size > 0; data++, size--) {
+                crc = __crc32cb(crc, *data);
+            }
+            return crc;
+        }
+
+        inline bool hasHardware() { return true; }
+#else
+        inline uint32_t hardware(uint32_t crc, const uint8_t* data, size_t size) {
+            return software(crc, data, size);
+        }
+
+        inline bool hasHardware() { return false; }
+#endif
+
+        // Continues crc (initially 0) over data
+        inline uint32_t update(uint32_t crc, const uint8_t* data, size_t size) {
+            crc = ~crc;
+            crc = hasHardware() ? hardware(crc, data, size) : software(crc, data, size);
+            return ~crc;
+        }
+    }
+
+    // Streaming XXH64 with seed 0, the hash zstd's checksumFlag stores the low
+    // 32 bits of. libzstd's own copy is not exported by every build.
+    class Xxh64 {
+    public:
+        void update(const uint8_t* data, size_t size) {
+            total_ += size;
+            if (buffered_ + size < 32) {
+                std::memcpy(buffer_ + buffered_, data, size);
+                buffered_ += size;
+                return;
+            }
+            if (buffered_ > 0) {
+                const size_t fill = 32 - buffered_;
+                std::memcpy(buffer_ + buffered_, data, fill);
+                stripe(buffer_);
+                data += fill;
+                size -= fill;
+                buffered_ = 0;
+            }
+            for (; size >= 32; data += 32, size -= 32) {
+                stripe(data);
+            }
+            std::memcpy(buffer_, data, size);
+            buffered_ = size;
+        }
+
+        uint64_t digest() const {
+            uint64_t hash;
+            if (total_ >= 32) {
+                hash = rotl(acc_[0], 1) + rotl(acc_[1], 7) + rotl(acc_[2], 12) + rotl(acc_[3], 18);
+                for (uint64_t acc : acc_) {
+                    hash = (hash ^ round(0, acc)) * P1 + P4;
+                }
+            } else {
+                hash = P5;
+            }
+            hash += total_;
+
+            const uint8_t* p = buffer_;
+            size_t size = buffered_;
+            for (; size >= 8; p += 8, size -= 8) {
+                hash = rotl(hash ^ round(0, read64(p)), 27) * P1 + P4;
+            }
+            if (size >= 4) {
+                hash = rotl(hash ^ (read32(p) * P1), 23) * P2 + P3;
+                p += 4;
+                size -= 4;
+            }
+            for (; size > 0; p++, size--) {
+                hash = rotl(hash ^ (*p * P5), 11) * P1;
+            }
+
+            hash ^= hash >> 33;
+            hash *= P2;
+            hash ^= hash >> 29;
+            hash *= P3;
+            hash ^= hash >> 32;
+            return hash;
+        }
+
+    private:
+        static constexpr uint64_t P1 = 0x9E3779B185EBCA87ULL;
+        static constexpr uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+        static constexpr uint64_t P3 = 0x165667B19E3779F9ULL;
+        static constexpr uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+        static constexpr uint64_t P5 = 0x27D4EB2F165667C5ULL;
+
+        static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+        static uint64_t round(uint64_t acc, uint64_t input) { return rotl(acc + input * P2, 31) * P1; }
+
+        // Little-endian reads, as the hash is defined
+        static uint64_t read64(const uint8_t* p) {
+            uint64_t value;
+            std::memcpy(&value, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            value = __builtin_bswap64(value);
+#endif
+            return value;
+        }
+        static uint64_t read32(const uint8_t* p) {
+            uint32_t value;
+            std::memcpy(&value, p, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            value = __builtin_bswap32(value);
+#endif
+            return value;
+        }
+
+        void stripe(const uint8_t* p) {
+            for (int i = 0; i < 4; i++) {
+                acc_[i] = round(acc_[i], read64(p + 8 * i));
+            }
+        }
+
+        uint64_t acc_[4] = { P1 + P2, P2, 0, 0 - P1 };
+        uint64_t total_ = 0;
+        uint8_t buffer_[32] = {};
+        size_t buffered_ = 0;
+    };
+
+    class Digest {
+    public:
+        explicit Digest(DigestKind kind = DIGEST_NONE) : kind_(kind) {}
+
+        explicit operator bool() const { return kind_ != DIGEST_NONE; }
+
+        void update(const uint8_t* data, size_t size) {
+            if (kind_ == DIGEST_XXH64) {
+                xxh64_.update(data, size);
+            } else if (kind_ == DIGEST_CRC32C) {
+                crc_ = crc32c::update(crc_, data, size);
+            }
+        }
+
+        std::string hex() const {
+            const uint64_t value = kind_ == DIGEST_XXH64 ? xxh64_.digest() : crc_;
+            const int digits = kind_ == DIGEST_XXH64 ? 16 : 8;
+            std::string text(digits, '0');
+            for (int i = 0; i < digits; i++) {
+                text[digits - 1 - i] = "0123456789abcdef"[(value >> (4 * i)) & 0xF];
+            }
+            return text;
+        }
+
+    private:
+        DigestKind kind_;
+        Xxh64 xxh64_;
+        uint32_t crc_ = 0;
+    };
+
+    // { digest: 'xxh64' | 'crc32c' } of the entry points that compute one
+    inline DigestKind getDigestOption(const Napi::Value& options) {
+        if (!options.IsObject()) {
+            return DIGEST_NONE;
+        }
+        const Napi::Value value = options.As<Napi::Object>().Get("digest");
+        if (value.IsUndefined()) {
+            return DIGEST_NONE;
+        }
+        const std::string name = value.IsString() ? value.As<Napi::String>().Utf8Value() : std::string();
+        if (name == "xxh64") {
+            return DIGEST_XXH64;
+        }
+        if (name == "crc32c") {
+            return DIGEST_CRC32C;
+        }
+        throw std::runtime_error("Option digest must be 'xxh64' or 'crc32c'");
+    }
+
+    // The result of a call that computed a digest: { buffer, digest }
+    inline Napi::Value withDigest(Napi::Env env, Napi::Value buffer, const Digest& digest) {
+        if (!digest) {
+            return buffer;
+        }
+        auto result = Napi::Object::New(env);
+        result.Set("buffer", buffer);
+        result.Set("digest", Napi::String::New(env, digest.hex()));
+        return result;
+    }
+
+    struct CompressOptions {
+        int level = DEFAULT_LEVEL;
+        DictionaryPtr dictionary;
+
+        // Set by { adapt }; replaces level with the controller's choice
+        std::shared_ptr<AdaptiveLevel> adapt;
+
+        int currentLevel() const { return adapt ? adapt->level() : level; }
+
+        // Reports a finished call to the controller, if any
+        void observe(size_t bytes, uint64_t nanos) const {
+            if (adapt) {
+                adapt->observe(bytes, nanos);
+            }
+        }
+
+        // Multithreading: workers < 0 means pick from the input size
+        static constexpr int AUTO_WORKERS = -1;
+        int workers = 0;
+
+        // Explicitly set advanced parameters, in COMPRESS_PARAMETERS order,
+        // followed by any an entry point derives (see applyDeltaParameters)
+        ParameterList parameters;
+
+        // Store input that does not compress behind RAW_MARKER instead
+        bool rawFallback = false;
+
+        // compressDelta base, referenced with ZSTD_CCtx_refPrefix for one frame
+        const uint8_t* prefix = nullptr;
+        size_t prefixSize = 0;
+
+        // { signal, deadlineMs } of the entry points that take them
+        CancellationPtr cancel;
+
+        // compressFile: digest of the written file
+        DigestKind digest = DIGEST_NONE;
+
+        int workersFor(unsigned long long srcSize) const {
+            int count = workers;
+            if (count == AUTO_WORKERS) {
+                const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+                const unsigned long long jobs = srcSize == ZSTD_CONTENTSIZE_UNKNOWN ?
+                    hardware : srcSize / AUTO_WORKER_INPUT_SIZE;
+                count = jobs < 2 ? 0 : static_cast<int>(std::min<unsigned long long>(jobs, hardware));
+            }
+            return std::min(count, maxWorkers());
+        }
+    };
+
+    struct DecompressOptions {
+        DictionaryPtr dictionary;
+        // Accept input stored by { rawFallback }
+        bool rawFallback = false;
+        // Skip checksumFlag verification (ZSTD_d_forceIgnoreChecksum), for
+        // trusted input
+        bool ignoreChecksum = false;
+
+        // decompressDelta base, and the ZSTD_d_windowLogMax its frames need
+        const uint8_t* prefix = nullptr;
+        size_t prefixSize = 0;
+        int windowLogMax = 0;
+
+        CancellationPtr cancel;
+
+        // Digest of the output, for the entry points that compute one
+        DigestKind digest = DIGEST_NONE;
+    };
+
+    inline double getPositiveOption(const Napi::Object& object, const char* name) {
+        const Napi::Value value = object.Get(name);
+        if (value.IsUndefined()) {
+            return 0;
+        }
+        const double number = value.IsNumber() ? value.As<Napi::Number>().DoubleValue() : -1;
+        if (!(number > 0) || !std::isfinite(number)) {
+            throw std::runtime_error(std::string("Option adapt.") + name + " must be a positive number");
+        }
+        return number;
+    }
+
+    // { minLevel, maxLevel, targetThroughput (MB/s), maxLatency (ms) }; at
+    // least one target is required. The controller starts from start.
+    std::shared_ptr<AdaptiveLevel> getAdaptiveLevel(const Napi::Value& value, int start) {
+        if (!value.IsObject()) {
+            throw std::runtime_error("Option adapt must be an object with targetThroughput or maxLatency");
+        }
+        auto object = value.As<Napi::Object>();
+        const auto level = [&](const char* name, int fallback) {
+            const Napi::Value entry = object.Get(name);
+            if (entry.IsUndefined()) {
+                return std::clamp(fallback, ZSTD_minCLevel(), ZSTD_maxCLevel());
+            }
+            if (!entry.IsNumber()) {
+                throw std::runtime_error(std::string("Option adapt.") + name + " must be a number");
+            }
+            return validateLevel(entry.As<Napi::Number>().Int32Value());
+        };
+        const int minLevel = level("minLevel", DEFAULT_ADAPT_MIN_LEVEL);
+        const int maxLevel = level("maxLevel", DEFAULT_ADAPT_MAX_LEVEL);
+        if (minLevel > maxLevel) {
+            throw std::runtime_error("Option adapt.minLevel must not exceed adapt.maxLevel");
+        }
+        const double targetThroughput = getPositiveOption(object, "targetThroughput");
+        const double maxLatency = getPositiveOption(object, "maxLatency") * 1e6;
+        if (targetThroughput == 0 && maxLatency == 0) {
+            throw std::runtime_error("Option adapt needs targetThroughput or maxLatency");
+        }
+        return std::make_shared<AdaptiveLevel>(start, minLevel, maxLevel, targetThroughput, maxLatency);
+    }
+
+    // Accepts a level number or { level, dictionary, workers, ...parameters }.
+    // Without an explicit level, the level the dictionary was loaded with is used.
+    CompressOptions getCompressOptions(const Napi::CallbackInfo& info, size_t index) {
+        CompressOptions options;
+        if (info.Length() <= index || info[index].IsUndefined() || info[index].IsNull()) {
+            return options;
+        }
+        if (info[index].IsNumber()) {
+            options.level = getLevel(info, index);
+            return options;
+        }
+        if (!info[index].IsObject()) {
+            throw std::runtime_error("Options must be a compression level or an object");
+        }
+
+        auto object = info[index].As<Napi::Object>();
+        options.dictionary = getDictionary(object.Get("dictionary"));
+        const Napi::Value level = object.Get("level");
+        if (level.IsNumber()) {
+            options.level = validateLevel(level.As<Napi::Number>().Int32Value());
+        } else if (!level.IsUndefined()) {
+            throw std::runtime_error("Option level must be a number");
+        } else if (options.dictionary) {
+            options.level = options.dictionary->level();
+        }
+
+        const Napi::Value workers = object.Get("workers");
+        if (workers.IsString() && workers.As<Napi::String>().Utf8Value() == "auto") {
+            options.workers = CompressOptions::AUTO_WORKERS;
+        } else {
+            options.workers = static_cast<int>(getUnsignedOption(object, "workers", 0, 200));
+        }
+
+        const Napi::Value adapt = object.Get("adapt");
+        if (!adapt.IsUndefined()) {
+            options.adapt = getAdaptiveLevel(adapt, options.level);
+        }
+        options.rawFallback = getBooleanOption(object, "rawFallback");
+
+        for (const CompressParameterName& entry : COMPRESS_PARAMETERS) {
+            const Napi::Value value = object.Get(entry.name);
+            if (!value.IsUndefined()) {
+                options.parameters.emplace_back(entry.param, getParameterValue(value, entry));
+            }
+        }
+        return options;
+    }
+
+    DecompressOptions getDecompressOptions(const Napi::CallbackInfo& info, size_t index) {
+        DecompressOptions options;
+        if (info.Length() <= index || info[index].IsUndefined() || info[index].IsNull()) {
+            return options;
+        }
+        if (!info[index].IsObject()) {
+            throw std::runtime_error("Options must be an object");
+        }
+        auto object = info[index].As<Napi::Object>();
+        options.dictionary = getDictionary(object.Get("dictionary"));
+        options.rawFallback = getBooleanOption(object, "rawFallback");
+        options.ignoreChecksum = getBooleanOption(object, "ignoreChecksum");
+#ifndef ZSTD_d_forceIgnoreChecksum
+        if (options.ignoreChecksum) {
+            throw std::runtime_error("Option ignoreChecksum needs libzstd 1.4.7 or later");
+        }
+#endif
+        return options;
+    }
+
+    // Writable byte range inside caller-supplied memory, which may be shared
+    // with other threads through a SharedArrayBuffer
+    inline ByteSpan getWritableSpan(const Napi::Value& value, const char* name) {
+        ByteSpan span;
+        if (!getByteSpan(asByteView(value), span)) {
+            throw std::runtime_error(std::string(name) + " must be a Buffer, TypedArray, DataView or ArrayBuffer");
+        }
+        return span;
+    }
+
+    // Resolves the (dst, offset) argument pair of the *Into entry points
+    inline ByteSpan getDestination(const Napi::CallbackInfo& info, size_t index) {
+        if (info.Length() <= index) {
+            throw std::runtime_error("Destination must be a Buffer, TypedArray, DataView or ArrayBuffer");
+        }
+        ByteSpan dst = getWritableSpan(info[index], "Destination");
+
+        size_t offset = 0;
+        if (info.Length() > index + 1 && !info[index + 1].IsUndefined()) {
+            if (!info[index + 1].IsNumber()) {
+                throw std::runtime_error("Offset must be a number");
+            }
+            offset = safeConvertToSizeT(info[index + 1].As<Napi::Number>().Int64Value(), "Offset");
+        }
+        if (offset > dst.size) {
+            throw std::runtime_error("Offset " + std::to_string(offset) +
+                                     " is outside the destination of " +
+                                     std::to_string(dst.size) + " bytes");
+        }
+        return { dst.data + offset, dst.size - offset };
+    }
+
+    inline void checkParameter(size_t result, const char* name) {
+        if (ZSTD_isError(result)) {
+            throw std::runtime_error(std::string("Invalid compression parameter ") + name + ": " +
+                                     ZSTD_getErrorName(result));
+        }
+    }
+
+    // Resets cctx and applies options for ZSTD_compress2/ZSTD_compressStream2
+    // at the given level (options.currentLevel() unless a caller has already
+    // read it). srcSize may be ZSTD_CONTENTSIZE_UNKNOWN for streams.
+    void applyCompressParameters(ZSTD_CCtx* cctx, const CompressOptions& options,
+                                 unsigned long long srcSize, int level) {
+        checkParameter(ZSTD_CCtx_reset(cctx, ZSTD_reset_session_and_parameters), "reset");
+        checkParameter(ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level), "level");
+
+        const int workers = options.workersFor(srcSize);
+        if (workers > 0) {
+            checkParameter(ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, workers), "workers");
+        }
+        for (const auto& parameter : options.parameters) {
+            // Job parameters are rejected by single-threaded builds
+            if (workers == 0 && (parameter.first == ZSTD_c_jobSize || parameter.first == ZSTD_c_overlapLog)) {
+                continue;
+            }
+            checkParameter(ZSTD_CCtx_setParameter(cctx, parameter.first, parameter.second), "value");
+        }
+
+        if (options.dictionary) {
+            checkParameter(ZSTD_CCtx_refCDict(cctx, options.dictionary->cdict(level)), "dictionary");
+        }
+    }
+
+    struct CCtxParamsDeleter {
+        void operator()(ZSTD_CCtx_params* params) const { ZSTD_freeCCtxParams(params); }
+    };
+
+    // Memory a compression context needs for options at the given level, from
+    // ZSTD_estimateCCtxSize_usingCCtxParams (or its CStream counterpart, which
+    // adds the stream buffers). A known srcSize is passed as ZSTD_c_srcSizeHint,
+    // so small inputs are not charged tables sized for unknown ones. libzstd
+    // only estimates single-threaded contexts; multithreaded ones are counted
+    // once per worker plus the caller's.
+    size_t estimateCompressMemory(const CompressOptions& options, unsigned long long srcSize, int level,
+                                  bool stream) {
+        std::unique_ptr<ZSTD_CCtx_params, CCtxParamsDeleter> params(ZSTD_createCCtxParams());
+        if (!params) {
+            throw std::runtime_error("Failed to create compression parameters");
+        }
+        ZSTD_CCtxParams_init(params.get(), level);
+        for (const auto& parameter : options.parameters) {
+            if (parameter.first != ZSTD_c_jobSize && parameter.first != ZSTD_c_overlapLog) {
+                ZSTD_CCtxParams_setParameter(params.get(), parameter.first, parameter.second);
+            }
+        }
+        if (srcSize != ZSTD_CONTENTSIZE_UNKNOWN && srcSize > 0) {
+            ZSTD_CCtxParams_setParameter(params.get(), ZSTD_c_srcSizeHint,
+                                         static_cast<int>(std::min<unsigned long long>(srcSize, INT_MAX)));
+        }
+        const size_t size = stream ?
+            ZSTD_estimateCStreamSize_usingCCtxParams(params.get()) :
+            ZSTD_estimateCCtxSize_usingCCtxParams(params.get());
+        if (ZSTD_isError(size)) {
+            throw std::runtime_error(std::string("Failed to estimate context size: ") + ZSTD_getErrorName(size));
+        }
+        return size * (options.workersFor(srcSize) + 1);
+    }
+
+    // Window log of the frames options produce for inputs of srcSize bytes
+    inline int windowLogOf(const CompressOptions& options, unsigned long long srcSize, int level) {
+        for (const auto& parameter : options.parameters) {
+            if (parameter.first == ZSTD_c_windowLog && parameter.second != 0) {
+                return parameter.second;
+            }
+        }
+        return static_cast<int>(ZSTD_getCParams(level, srcSize, 0).windowLog);
+    }
+
+    // A compression context that remembers the parameters last applied to it,
+    // so repeated calls with the same options skip the reset/setParameter
+    // sequence. ZSTD_compress2 keeps parameters across frames.
+    class CompressionContext {
+    public:
+        CompressionContext() : cctx_(createCCtx()) {}
+
+        // A static context in an arena slot, charged with the arena
+        CompressionContext(uint8_t* workspace, size_t size)
+            : cctx_(ZSTD_initStaticCCtx(workspace, size)), static_(true) {
+            if (!cctx_) {
+                throw std::runtime_error("Failed to create compression context");
+            }
+        }
+
+        bool isStatic() const { return static_; }
+
+        ZSTD_CCtx* prepare(const CompressOptions& options, unsigned long long srcSize) {
+            const int workers = options.workersFor(srcSize);
+            const int level = options.currentLevel();
+            if (static_ && workers > 0) {
+                throw std::runtime_error("Arena contexts are single-threaded; workers are not available");
+            }
+            // Charged ahead of the call, then trued up by settle()
+            if (!static_ && memoryLimited()) {
+                memory_.reserve(estimateCompressMemory(options, srcSize, level, false));
+            }
+            const ZSTD_CDict* cdict = options.dictionary ? options.dictionary->cdict(level) : nullptr;
+            const bool same = applied_ &&
+                appliedLevel_ == level &&
+                appliedWorkers_ == workers &&
+                appliedParameters_ == options.parameters &&
+                appliedCDict_ == cdict &&
+                (!cdict || !appliedDictionary_.expired()) &&
+                (!prefixed_ || options.prefix);
+            if (!same) {
+                applied_ = false;
+                applyCompressParameters(cctx_.get(), options, srcSize, level);
+                appliedLevel_ = level;
+                appliedWorkers_ = workers;
+                appliedParameters_ = options.parameters;
+                appliedCDict_ = cdict;
+                appliedDictionary_ = options.dictionary;
+                applied_ = true;
+            }
+
+            // A prefix applies to the next frame only; one left over by a
+            // failed call is dropped by the full reset above
+            prefixed_ = options.prefix != nullptr;
+            if (options.prefix) {
+                checkParameter(ZSTD_CCtx_refPrefix(cctx_.get(), options.prefix, options.prefixSize), "prefix");
+            }
+            return cctx_.get();
+        }
+
+        // Charges what the context holds after a call
+        void settle() {
+            if (!static_) {
+                memory_.set(ZSTD_sizeof_CCtx(cctx_.get()));
+            }
+        }
+
+    private:
+        // Static contexts live in memory they do not own; freeing one is a no-op
+        CCtxPtr cctx_;
+        bool static_ = false;
+        MemoryCharge memory_{ MEMORY_CONTEXTS };
+        bool applied_ = false;
+        int appliedLevel_ = 0;
+        int appliedWorkers_ = 0;
+        ParameterList appliedParameters_;
+        const ZSTD_CDict* appliedCDict_ = nullptr;
+        std::weak_ptr<const DictionaryData> appliedDictionary_;
+        bool prefixed_ = false;
+    };
+
+    // Per-thread context pool. Threadpool threads live as long as the process,
+    // so every thread that ever runs a job keeps one warm context of each kind
+    // instead of paying ZSTD_createCCtx/ZSTD_freeCCtx on each call.
+    CompressionContext& threadCCtx() {
+        thread_local std::unique_ptr<CompressionContext> context;
+        if (!context || !context->isStatic()) {
+            ContextArena* arena = contextArena();
+            if (arena && !arena->compressFull()) {
+                if (uint8_t* slot = arena->takeCompress()) {
+                    context = std::make_unique<CompressionContext>(slot, arena->compressSlotSize());
+                    countStat(STAT_CCTX_MISSES);
+                    return *context;
+                }
+            }
+        }
+        if (!context) {
+            context = std::make_unique<CompressionContext>();
+            countStat(STAT_CCTX_MISSES);
+        } else {
+            countStat(STAT_CCTX_HITS);
+        }
+        return *context;
+    }
+
+    // Compresses src into dst and returns the number of bytes written
+    size_t compressTo(CompressionContext& context, uint8_t* dst, size_t dstCapacity,
+                      const uint8_t* src, size_t srcSize, const CompressOptions& options,
+                      bool mayNotFit = false) {
+        ZSTD_CCtx* cctx = context.prepare(options, srcSize);
+        const CodecTimer timer(true);
+        const size_t compSize = ZSTD_compress2(
+            cctx,
+            dst,
+            dstCapacity,
+            src,
+            srcSize
+        );
+        context.settle();
+
+        // A frame too large for dst is reported as 0 to callers with a fallback
+        if (mayNotFit && ZSTD_getErrorCode(compSize) == ZSTD_error_dstSize_tooSmall) {
+            return 0;
+        }
+        // Check for compression errors
+        if (ZSTD_isError(compSize)) {
+            throw std::runtime_error(std::string("Compression failed: ") + ZSTD_getErrorName(compSize));
+        }
+        options.observe(srcSize, timer.record(srcSize, compSize));
+        return compSize;
+    }
+
+    // Applies the single-use decoder state of options (delta base and window
+    // limit) to dctx; the caller resets its parameters afterwards
+    void referencePrefix(ZSTD_DCtx* dctx, const DecompressOptions& options) {
+        size_t result = ZSTD_DCtx_refPrefix(dctx, options.prefix, options.prefixSize);
+        if (!ZSTD_isError(result) && options.windowLogMax > 0) {
+            result = ZSTD_DCtx_setParameter(dctx, ZSTD_d_windowLogMax, options.windowLogMax);
+        }
+        if (ZSTD_isError(result)) {
+            throw std::runtime_error(std::string("Decompression failed: ") + ZSTD_getErrorName(result));
+        }
+    }
+
+    // { ignoreChecksum }: frames' checksums are neither computed nor verified
+    inline void applyChecksumMode(ZSTD_DCtx* dctx, const DecompressOptions& options) {
+#ifdef ZSTD_d_forceIgnoreChecksum
+        if (options.ignoreChecksum) {
+            const size_t result = ZSTD_DCtx_setParameter(dctx, ZSTD_d_forceIgnoreChecksum, ZSTD_d_ignoreChecksum);
+            if (ZSTD_isError(result)) {
+                throw std::runtime_error(std::string("Decompression failed: ") + ZSTD_getErrorName(result));
+            }
+        }
+#else
+        (void)dctx;
+        (void)options;
+#endif
+    }
+
+    // Decompresses all frames of src into dst and returns the number of bytes written
+    size_t decompressTo(ZSTD_DCtx* dctx, uint8_t* dst, size_t dstCapacity,
+                        const uint8_t* src, size_t srcSize, const DecompressOptions& options) {
+        // Pooled contexts are shared with calls that take no prefix, and that
+        // verify checksums
+        struct PrefixGuard {
+            ZSTD_DCtx* dctx;
+            ~PrefixGuard() {
+                if (dctx) {
+                    ZSTD_DCtx_reset(dctx, ZSTD_reset_session_and_parameters);
+                }
+            }
+        } guard{ options.prefix || options.ignoreChecksum ? dctx : nullptr };
+        if (options.prefix) {
+            referencePrefix(dctx, options);
+        }
+        applyChecksumMode(dctx, options);
+
+        const CodecTimer timer(false);
+        const size_t result = options.dictionary ?
+            ZSTD_decompress_usingDDict(
+                dctx,
+                dst,
+                dstCapacity,
+                src,
+                srcSize,
+                options.dictionary->ddict()
+            ) :
+            ZSTD_decompressDCtx(
+                dctx,
+                dst,
+                dstCapacity,
+                src,
+                srcSize
+            );
+
+        // Check for decompression errors
+        if (ZSTD_isError(result)) {
+            throw std::runtime_error(std::string("Decompression failed: ") + ZSTD_getErrorName(result));
+        }
+        timer.record(srcSize, result);
+        return result;
+    }
+
+    // Smallest first allocation of an output block that grows as it fills
+    constexpr size_t MIN_GROWING_OUTPUT = 64 * 1024;
+
+    // Inputs from this size on are compressed into a growing block rather
+    // than one of ZSTD_compressBound size, whose first allocation assumes
+    // the ratio below
+    constexpr size_t GROWING_COMPRESS_THRESHOLD = 8ULL << 20;
+    constexpr size_t GROWING_COMPRESS_RATIO = 4;
+
+    // Compresses src with ZSTD_compressStream2 into a block that doubles
+    // whenever it fills, up to min(bound, maxOutput). Only the output that is
+    // actually produced is checked against the limit, so a pessimistic bound
+    // does not reject data that compresses well. The pledged size still goes
+    // into the frame header. Cancellable calls of any size come here, fed
+    // CANCEL_COMPRESS_STEP bytes per step; below the growing threshold they
+    // get their bound up front.
+    OutputBuffer compressGrowing(CompressionContext& context, const uint8_t* src, size_t srcSize,
+                                 const CompressOptions& options, const SizeLimits& limits,
+                                 size_t bound) {
+        ZSTD_CCtx* cctx = context.prepare(options, srcSize);
+        // A frame abandoned halfway must not leak into the next call
+        struct ResetGuard {
+            CompressionContext& context;
+            ZSTD_CCtx* cctx;
+            ~ResetGuard() {
+                ZSTD_CCtx_reset(cctx, ZSTD_reset_session_only);
+                context.settle();
+            }
+        } guard{ context, cctx };
+        checkParameter(ZSTD_CCtx_setPledgedSrcSize(cctx, srcSize), "pledged size");
+
+        const size_t cap = std::min(bound, limits.maxOutput);
+        OutputBuffer out(srcSize < GROWING_COMPRESS_THRESHOLD && options.cancel ? cap :
+                         std::min(cap, std::max(MIN_GROWING_OUTPUT, srcSize / GROWING_COMPRESS_RATIO)));
+
+        const CodecTimer timer(true);
+        ZSTD_inBuffer in = { src, srcSize, 0 };
+        size_t written = 0;
+        for (;;) {
+            checkCancelled(options.cancel);
+            if (options.cancel) {
+                in.size = std::min(srcSize, in.pos + CANCEL_COMPRESS_STEP);
+            }
+            const ZSTD_EndDirective mode = in.size == srcSize ? ZSTD_e_end : ZSTD_e_continue;
+            ZSTD_outBuffer output = { out.data(), out.capacity(), written };
+            const size_t remaining = ZSTD_compressStream2(cctx, &output, &in, mode);
+            if (ZSTD_isError(remaining)) {
+                throw std::runtime_error(std::string("Compression failed: ") + ZSTD_getErrorName(remaining));
+            }
+            written = output.pos;
+            if (mode == ZSTD_e_end && remaining == 0) {
+                break;
+            }
+            if (output.pos < output.size) {
+                continue;
+            }
+
+            if (out.capacity() >= cap) {
+                throw std::runtime_error("Output size exceeds maximum allowed size " +
+                                         std::to_string(limits.maxOutput));
+            }
+            out.grow(std::min(out.capacity() * 2, cap));
+        }
+        options.observe(srcSize, timer.record(srcSize, written));
+
+        out.setSize(written);
+        out.shrinkToFit();
+        return out;
+    }
+
+    // Leading byte of input stored by { rawFallback } because its frame would
+    // be larger. No zstd frame (0x28) or skippable frame (0x5?) starts with it.
+    constexpr uint8_t RAW_MARKER = 0x00;
+
+    // Returns src behind RAW_MARKER if that is smaller than the frame
+    OutputBuffer storeRaw(OutputBuffer frame, const uint8_t* src, size_t srcSize) {
+        if (frame.size() <= srcSize + 1) {
+            return frame;
+        }
+        OutputBuffer stored(srcSize + 1);
+        stored.data()[0] = RAW_MARKER;
+        std::memcpy(stored.data() + 1, src, srcSize);
+        stored.setSize(srcSize + 1);
+        return stored;
+    }
+
+    // Compresses src into a new buffer using the given context, which must not
+    // be shared with a concurrent call. Safe to call from any thread.
+    // malloc'd output is never zero-filled; small inputs get one block of
+    // ZSTD_compressBound size that is trimmed afterwards, large ones (or any
+    // whose bound exceeds the output limit) a growing one.
+    OutputBuffer compressData(CompressionContext& context, const uint8_t* src, size_t srcSize,
+                              const CompressOptions& options, const SizeLimits& limits) {
+        // Check input size
+        validateSize(srcSize, limits.maxInput, "Input");
+
+        // Fast path for empty input
+        if (srcSize == 0) {
+            return {};
+        }
+
+        checkCancelled(options.cancel);
+        const size_t bound = ZSTD_compressBound(srcSize);
+        if (ZSTD_isError(bound)) {
+            throw std::runtime_error("Input size " + std::to_string(srcSize) + " is too large to compress");
+        }
+        OutputBuffer out;
+        if (srcSize >= GROWING_COMPRESS_THRESHOLD || bound > limits.maxOutput || options.cancel) {
+            out = compressGrowing(context, src, srcSize, options, limits, bound);
+        } else {
+            out = OutputBuffer(bound);
+            out.setSize(compressTo(context, out.data(), bound, src, srcSize, options));
+            out.shrinkToFit();
+        }
+        return options.rawFallback ? storeRaw(std::move(out), src, srcSize) : std::move(out);
+    }
+
+    // Inputs up to this size are compressed through a stack buffer straight
+    // into a JS Buffer. That costs less than a threadpool round trip, so the
+    // asynchronous entry points finish them inline (see compressesInline).
+    constexpr size_t SMALL_INPUT_SIZE = 1024;
+    // Largest content the small path decodes inline
+    constexpr size_t SMALL_OUTPUT_SIZE = 16 * 1024;
+
+    // compressData for src of at most SMALL_INPUT_SIZE bytes: no output block
+    // is allocated, the frame is copied once into the returned Buffer
+    Napi::Buffer<uint8_t> compressSmall(Napi::Env env, CompressionContext& context, const uint8_t* src,
+                                        size_t srcSize, const CompressOptions& options, const SizeLimits& limits) {
+        checkCancelled(options.cancel);
+        validateSize(srcSize, limits.maxInput, "Input");
+        if (srcSize == 0) {
+            return Napi::Buffer<uint8_t>::New(env, 0);
+        }
+
+        uint8_t block[ZSTD_COMPRESSBOUND(SMALL_INPUT_SIZE)];
+        const size_t size = compressTo(context, block, sizeof(block), src, srcSize, options);
+        const bool store = options.rawFallback && size > srcSize + 1;
+        if ((store ? srcSize + 1 : size) > limits.maxOutput) {
+            throw std::runtime_error("Output size exceeds maximum allowed size " + std::to_string(limits.maxOutput));
+        }
+        if (store) {
+            auto stored = Napi::Buffer<uint8_t>::New(env, srcSize + 1);
+            stored.Data()[0] = RAW_MARKER;
+            std::memcpy(stored.Data() + 1, src, srcSize);
+            return stored;
+        }
+        return Napi::Buffer<uint8_t>::Copy(env, block, size);
+    }
+
+    // Whether zstdCompress may run compressSmall on the calling thread: only
+    // when nothing has to be built first. A dictionary's first use at a new
+    // level digests a CDict, which takes milliseconds, and workers or adapt
+    // set up per-call state; those calls still go to a worker thread.
+    inline bool compressesInline(const CompressOptions& options) {
+        if (options.adapt || options.workers != 0) {
+            return false;
+        }
+        return !options.dictionary || options.dictionary->hasCDict(options.level);
+    }
+
+    // Summary of the frames in a buffer, from their headers alone
+    struct FrameScan {
+        unsigned long long knownSize = 0; // sum of the declared content sizes
+        bool unknownSize = false;         // some frame omits its content size
+    };
+
+    // Walks every frame (skippable ones included) with
+    // ZSTD_findFrameCompressedSize, so truncated or trailing bytes are rejected
+    // before any output is allocated.
+    FrameScan scanFrames(const uint8_t* src, size_t srcSize) {
+        FrameScan scan;
+        size_t pos = 0;
+        while (pos < srcSize) {
+            const size_t frameSize = ZSTD_findFrameCompressedSize(src + pos, srcSize - pos);
+            if (ZSTD_isError(frameSize)) {
+                throw std::runtime_error(std::string("Invalid compressed data: ") +
+                                         ZSTD_getErrorName(frameSize));
+            }
+            const unsigned long long contentSize = ZSTD_getFrameContentSize(src + pos, frameSize);
+            if (contentSize == ZSTD_CONTENTSIZE_ERROR) {
+                throw std::runtime_error("Invalid compressed data: Unknown frame descriptor");
+            }
+            if (contentSize == ZSTD_CONTENTSIZE_UNKNOWN) {
+                scan.unknownSize = true;
+            } else if (contentSize > ULLONG_MAX - scan.knownSize) {
+                throw std::runtime_error("Invalid compressed data: Content size overflow");
+            } else {
+                scan.knownSize += contentSize;
+            }
+            pos += frameSize;
+        }
+        return scan;
+    }
+
+    // Output headroom for frames that omit their content size, as a ratio of
+    // the compressed size
+    constexpr size_t UNKNOWN_SIZE_RATIO = 4;
+
+    // Decompresses frames of unknown content size with ZSTD_decompressStream
+    // into a buffer that doubles whenever it fills, up to the output limit.
+    // The first allocation is the declared sizes plus headroom for the rest,
+    // clamped to ZSTD_decompressBound. Cancellable calls come here whatever
+    // their sizes, producing at most CANCEL_DECOMPRESS_STEP bytes per step, and
+    // so do digested ones, which hash each DIGEST_STEP of output as it is made.
+    OutputBuffer decompressGrowing(ZSTD_DCtx* dctx, const uint8_t* src, size_t srcSize,
+                                   const DecompressOptions& options, const SizeLimits& limits,
+                                   const FrameScan& scan, Digest* digest) {
+        validateSize(scan.knownSize, limits.maxOutput, "Output");
+
+        unsigned long long initial = scan.knownSize + std::max<unsigned long long>(
+            MIN_GROWING_OUTPUT, static_cast<unsigned long long>(srcSize) * UNKNOWN_SIZE_RATIO);
+        const unsigned long long bound = ZSTD_decompressBound(src, srcSize);
+        if (bound != ZSTD_CONTENTSIZE_ERROR) {
+            initial = std::min(initial, bound);
+        }
+        initial = std::min<unsigned long long>(initial, limits.maxOutput);
+        OutputBuffer out(static_cast<size_t>(std::max<unsigned long long>(initial, 1)));
+
+        // Window and block buffers the context allocates for streaming
+        MemoryCharge buffers(MEMORY_CONTEXTS);
+        const size_t streamSize = ZSTD_estimateDStreamSize_fromFrame(src, srcSize);
+        if (!ZSTD_isError(streamSize)) {
+            buffers.reserve(streamSize - std::min(streamSize, ZSTD_estimateDCtxSize()));
+        }
+
+        // The pooled context is shared with the one-shot path, which would pick
+        // up a referenced dictionary, so parameters are cleared on every exit
+        struct ResetGuard {
+            ZSTD_DCtx* dctx;
+            ~ResetGuard() { ZSTD_DCtx_reset(dctx, ZSTD_reset_session_and_parameters); }
+        } guard{ dctx };
+        ZSTD_DCtx_reset(dctx, ZSTD_reset_session_and_parameters);
+        if (options.dictionary) {
+            const size_t result = ZSTD_DCtx_refDDict(dctx, options.dictionary->ddict());
+            if (ZSTD_isError(result)) {
+                throw std::runtime_error(std::string("Decompression failed: ") + ZSTD_getErrorName(result));
+            }
+        }
+        // Frames that all declare their size are only here to be stepped;
+        // the one-shot path has no window limit, and the output limit already
+        // bounds what they can make the decoder allocate
+        if (!scan.unknownSize) {
+            checkParameter(ZSTD_DCtx_setParameter(dctx, ZSTD_d_windowLogMax, ZSTD_WINDOWLOG_MAX), "window log");
+        }
+        if (options.prefix) {
+            referencePrefix(dctx, options);
+        }
+        applyChecksumMode(dctx, options);
+
+        const CodecTimer timer(false);
+        ZSTD_inBuffer in = { src, srcSize, 0 };
+        size_t written = 0;
+        const size_t step = digest ? DIGEST_STEP : options.cancel ? CANCEL_DECOMPRESS_STEP : SIZE_MAX;
+        for (;;) {
+            checkCancelled(options.cancel);
+            ZSTD_outBuffer output = { out.data(), out.capacity(), written };
+            output.size = written + std::min(output.size - written, step);
+            const size_t result = ZSTD_decompressStream(dctx, &output, &in);
+            if (ZSTD_isError(result)) {
+                throw std::runtime_error(std::string("Decompression failed: ") + ZSTD_getErrorName(result));
+            }
+            if (digest) {
+                digest->update(out.data() + written, output.pos - written);
+            }
+            written = output.pos;
+
+            if (in.pos == in.size && result == 0) {
+                break;
+            }
+            if (output.pos < output.size) {
+                // Room left means the decoder wants input that is not there
+                if (in.pos == in.size) {
+                    throw std::runtime_error("Decompression failed: Truncated zstd stream");
+                }
+                continue;
+            }
+            if (output.size < out.capacity()) {
+                continue;
+            }
+
+            if (out.capacity() >= limits.maxOutput) {
+                throw std::runtime_error("Output size exceeds maximum allowed size " +
+                                         std::to_string(limits.maxOutput));
+            }
+            out.grow(std::min(out.capacity() * 2, limits.maxOutput));
+        }
+
+        validateSize(written, limits.maxOutput, "Output");
+        timer.record(srcSize, written);
+        out.setSize(written);
+        out.shrinkToFit();
+        return out;
+    }
+
+    // Decompresses every frame of src into a new buffer using the given
+    // context, which must not be shared with a concurrent call. When all frames
+    // declare their content size the output is allocated once and decoded in a
+    // single ZSTD_decompressDCtx call; otherwise it grows as it is filled.
+    // A digest, when given, is computed over the output in the same pass.
+    // Safe to call from any thread.
+    OutputBuffer decompressData(ZSTD_DCtx* dctx, const uint8_t* src, size_t srcSize,
+                                const DecompressOptions& options, const SizeLimits& limits,
+                                Digest* digest = nullptr) {
+        // Check input size
+        validateSize(srcSize, limits.maxInput, "Input");
+
+        if (srcSize == 0) {
+            return {};
+        }
+        checkCancelled(options.cancel);
+
+        if (options.rawFallback && src[0] == RAW_MARKER) {
+            validateSize(srcSize - 1, limits.maxOutput, "Output");
+            OutputBuffer out(srcSize - 1);
+            std::memcpy(out.data(), src + 1, srcSize - 1);
+            out.setSize(srcSize - 1);
+            if (digest) {
+                digest->update(out.data(), out.size());
+            }
+            return out;
+        }
+
+        const FrameScan scan = scanFrames(src, srcSize);
+        if (scan.unknownSize || options.cancel || digest) {
+            return decompressGrowing(dctx, src, srcSize, options, limits, scan, digest);
+        }
+
+        // Check decompressed size
+        validateSize(scan.knownSize, limits.maxOutput, "Output");
+
+        OutputBuffer out(scan.knownSize);
+        out.setSize(decompressTo(dctx, out.data(), scan.knownSize, src, srcSize, options));
+        return out;
+    }
+
+    // Content size of small input whose frames all declare at most
+    // SMALL_OUTPUT_SIZE bytes, which decompressSmall handles; nothing for any
+    // other input. Needs no context, so callers check it before taking one.
+    std::optional<size_t> smallContentSize(const uint8_t* src, size_t srcSize, const DecompressOptions& options) {
+        if (srcSize == 0 || srcSize > SMALL_INPUT_SIZE || (options.rawFallback && src[0] == RAW_MARKER)) {
+            return std::nullopt;
+        }
+        // Also rejects unknown sizes and invalid data, which the full path reports
+        const unsigned long long contentSize = ZSTD_findDecompressedSize(src, srcSize);
+        if (contentSize > SMALL_OUTPUT_SIZE) {
+            return std::nullopt;
+        }
+        return static_cast<size_t>(contentSize);
+    }
+
+    // decompressData for input accepted by smallContentSize, decoded through
+    // a stack buffer straight into a JS Buffer
+    Napi::Buffer<uint8_t> decompressSmall(Napi::Env env, ZSTD_DCtx* dctx, const uint8_t* src, size_t srcSize,
+                                          size_t contentSize, const DecompressOptions& options,
+                                          const SizeLimits& limits, Digest* digest = nullptr) {
+        checkCancelled(options.cancel);
+        validateSize(srcSize, limits.maxInput, "Input");
+        validateSize(contentSize, limits.maxOutput, "Output");
+
+        uint8_t block[SMALL_OUTPUT_SIZE];
+        const size_t size = decompressTo(dctx, block, contentSize, src, srcSize, options);
+        if (digest) {
+            digest->update(block, size);
+        }
+        return Napi::Buffer<uint8_t>::Copy(env, block, size);
+    }
+
+    // Delta compression (compressDelta/decompressDelta), like zstd
+    // --patch-from: the base is referenced in place as a raw-content prefix
+    // for a single frame, and must stay unmodified until the call settles.
+
+    // Smallest window log whose window covers size bytes
+    inline int windowLogFor(unsigned long long size) {
+        int log = ZSTD_WINDOWLOG_MIN;
+        while (log < ZSTD_WINDOWLOG_MAX && (1ULL << log) < size) {
+            log++;
+        }
+        return log;
+    }
+
+    // When the level's own window would not reach back over the whole base,
+    // widens it to base + input and turns on long-distance matching, which
+    // finds matches that far back cheaply. Parameters the caller set win.
+    void applyDeltaParameters(CompressOptions& options, size_t baseSize, size_t srcSize) {
+        const auto isSet = [&](ZSTD_cParameter param) {
+            return std::any_of(options.parameters.begin(), options.parameters.end(),
+                               [&](const auto& parameter) { return parameter.first == param; });
+        };
+        const int windowLog = windowLogFor(static_cast<unsigned long long>(baseSize) + srcSize);
+        if (windowLog <= static_cast<int>(ZSTD_getCParams(options.level, srcSize, baseSize).windowLog)) {
+            return;
+        }
+        if (!isSet(ZSTD_c_windowLog)) {
+            options.parameters.emplace_back(ZSTD_c_windowLog, windowLog);
+        }
+        if (!isSet(ZSTD_c_enableLongDistanceMatching)) {
+            options.parameters.emplace_back(ZSTD_c_enableLongDistanceMatching, 1);
+        }
+    }
+
+    // Frames made against a large base declare a window beyond the decoder's
+    // default limit; allow one that covers the base plus the largest output
+    inline int deltaWindowLogMax(size_t baseSize, const SizeLimits& limits) {
+        return std::max<int>(ZSTD_WINDOWLOG_LIMIT_DEFAULT,
+                             windowLogFor(static_cast<unsigned long long>(baseSize) + limits.maxOutput));
+    }
+
+    // Seekable format (zstd contrib/seekable_format): independent frames
+    // followed by a skippable frame holding the seek table. Each entry is
+    // { compressedSize, decompressedSize[, checksum] } as little-endian u32,
+    // and the table ends with a 9-byte footer { numFrames u32, descriptor u8,
+    // magic u32 }. Bit 7 of the descriptor marks entries with checksums.
+    constexpr uint32_t SEEKABLE_MAGIC = 0x8F92EAB1;
+    constexpr uint32_t SEEK_TABLE_MAGIC = ZSTD_MAGIC_SKIPPABLE_START | 0xE;
+    constexpr size_t SEEKABLE_FOOTER_SIZE = 9;
+    constexpr size_t SKIPPABLE_HEADER_SIZE = 8;
+    constexpr size_t SEEKABLE_MAX_FRAME_SIZE = 1ULL << 30;
+    constexpr size_t DEFAULT_SEEKABLE_FRAME_SIZE = 1ULL << 20;
+    constexpr uint8_t SEEKABLE_CHECKSUM_FLAG = 0x80;
+
+    inline void writeLE32(uint8_t* p, uint32_t value) {
+        p[0] = static_cast<uint8_t>(value);
+        p[1] = static_cast<uint8_t>(value >> 8);
+        p[2] = static_cast<uint8_t>(value >> 16);
+        p[3] = static_cast<uint8_t>(value >> 24);
+    }
+
+    inline uint32_t readLE32(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+               static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+    }
+
+    // Layout of a seekable compression of srcSize bytes. With checksumFlag each
+    // frame carries its XXH64 checksum and the low 32 bits the frame already
+    // ends with are copied into the table.
+    struct SeekableLayout {
+        SeekableLayout(const uint8_t* src, size_t srcSize, size_t frameSize, const CompressOptions& options)
+            : src(src), srcSize(srcSize), frameSize(frameSize),
+              frames((srcSize + frameSize - 1) / frameSize) {
+            if (frames > UINT32_MAX) {
+                throw std::runtime_error("Too many frames for the seek table");
+            }
+            for (const auto& parameter : options.parameters) {
+                if (parameter.first == ZSTD_c_checksumFlag) {
+                    checksum = parameter.second != 0;
+                }
+            }
+        }
+
+        size_t entrySize() const { return checksum ? 12 : 8; }
+        size_t tableSize() const { return SKIPPABLE_HEADER_SIZE + frames * entrySize() + SEEKABLE_FOOTER_SIZE; }
+        size_t frameBegin(size_t frame) const { return frame * frameSize; }
+        size_t frameLength(size_t frame) const { return std::min(frameSize, srcSize - frameBegin(frame)); }
+
+        // Worst-case size of frames [first, last)
+        size_t bound(size_t first, size_t last) const {
+            size_t total = 0;
+            for (size_t i = first; i < last; i++) {
+                total += ZSTD_compressBound(frameLength(i));
+            }
+            return total;
+        }
+
+        const uint8_t* src;
+        size_t srcSize;
+        size_t frameSize;
+        size_t frames;
+        bool checksum = false;
+    };
+
+    // Frames [first, last) compressed back to back, with their seek table
+    // entries { compressedSize, decompressedSize[, checksum] }
+    struct SeekableFrames {
+        OutputBuffer data;
+        std::vector<uint32_t> entries;
+    };
+
+    // Compresses frames [first, last) of the layout; reserve extra bytes are
+    // left free after them for the seek table.
+    SeekableFrames compressSeekableFrames(CompressionContext& context, const SeekableLayout& layout,
+                                          size_t first, size_t last, const CompressOptions& options,
+                                          size_t reserve = 0) {
+        const size_t bound = layout.bound(first, last) + reserve;
+        SeekableFrames frames;
+        frames.data = OutputBuffer(bound);
+        frames.entries.reserve((last - first) * 3);
+        size_t written = 0;
+        for (size_t i = first; i < last; i++) {
+            const size_t size = layout.frameLength(i);
+            const size_t compSize = compressTo(context, frames.data.data() + written, bound - written,
+                                               layout.src + layout.frameBegin(i), size, options);
+            frames.entries.push_back(static_cast<uint32_t>(compSize));
+            frames.entries.push_back(static_cast<uint32_t>(size));
+            if (layout.checksum) {
+                frames.entries.push_back(readLE32(frames.data.data() + written + compSize - 4));
+            }
+            written += compSize;
+        }
+        frames.data.setSize(written);
+        return frames;
+    }
+
+    // Writes the seek table for all frames at table, which has
+    // layout.tableSize() bytes of room
+    void writeSeekTable(uint8_t* table, const SeekableLayout& layout, const std::vector<uint32_t>& entries) {
+        writeLE32(table, SEEK_TABLE_MAGIC);
+        writeLE32(table + 4, static_cast<uint32_t>(layout.tableSize() - SKIPPABLE_HEADER_SIZE));
+        uint8_t* entry = table + SKIPPABLE_HEADER_SIZE;
+        for (const uint32_t value : entries) {
+            writeLE32(entry, value);
+            entry += 4;
+        }
+        writeLE32(entry, static_cast<uint32_t>(layout.frames));
+        entry[4] = layout.checksum ? SEEKABLE_CHECKSUM_FLAG : 0;
+        writeLE32(entry + 5, SEEKABLE_MAGIC);
+    }
+
+    struct SeekEntry {
+        size_t compressedOffset;
+        size_t compressedSize;
+        size_t decompressedOffset;
+        size_t decompressedSize;
+    };
+
+    // Parses and validates the seek table at the end of src; no entry may
+    // claim more content than the output limit allows
+    std::vector<SeekEntry> readSeekTable(const uint8_t* src, size_t srcSize, const SizeLimits& limits) {
+        if (srcSize < SKIPPABLE_HEADER_SIZE + SEEKABLE_FOOTER_SIZE ||
+            readLE32(src + srcSize - 4) != SEEKABLE_MAGIC) {
+            throw std::runtime_error("Invalid seekable data: Seek table not found");
+        }
+        const uint8_t* footer = src + srcSize - SEEKABLE_FOOTER_SIZE;
+        const size_t frames = readLE32(footer);
+        const uint8_t descriptor = footer[4];
+        if (descriptor & 0x7C) {
+            throw std::runtime_error("Invalid seekable data: Reserved descriptor bits set");
+        }
+        const size_t entrySize = (descriptor & SEEKABLE_CHECKSUM_FLAG) ? 12 : 8;
+        const size_t tableSize = SKIPPABLE_HEADER_SIZE + frames * entrySize + SEEKABLE_FOOTER_SIZE;
+        if (tableSize > srcSize) {
+            throw std::runtime_error("Invalid seekable data: Seek table is truncated");
+        }
+        const uint8_t* table = src + srcSize - tableSize;
+        if (readLE32(table) != SEEK_TABLE_MAGIC ||
+            readLE32(table + 4) != tableSize - SKIPPABLE_HEADER_SIZE) {
+            throw std::runtime_error("Invalid seekable data: Bad seek table header");
+        }
+
+        std::vector<SeekEntry> entries;
+        entries.reserve(frames);
+        const size_t dataSize = srcSize - tableSize;
+        size_t compressedOffset = 0;
+        size_t decompressedOffset = 0;
+        const uint8_t* entry = table + SKIPPABLE_HEADER_SIZE;
+        for (size_t i = 0; i < frames; i++, entry += entrySize) {
+            const size_t compressedSize = readLE32(entry);
+            const size_t decompressedSize = readLE32(entry + 4);
+            if (compressedSize > dataSize - compressedOffset) {
+                throw std::runtime_error("Invalid seekable data: Frame " + std::to_string(i) +
+                                         " is outside the data");
+            }
+            validateSize(decompressedSize, limits.maxOutput, "Output");
+            entries.push_back({ compressedOffset, compressedSize, decompressedOffset, decompressedSize });
+            compressedOffset += compressedSize;
+            decompressedOffset += decompressedSize;
+        }
+        return entries;
+    }
+
+    // Decompresses only the frames overlapping [offset, offset + length);
+    // the range is clipped at the end of the content. Fully covered frames are
+    // decoded in place, the partial ones at the edges through a scratch block.
+    OutputBuffer readSeekableRange(ZSTD_DCtx* dctx, const uint8_t* src, size_t srcSize,
+                                   size_t offset, size_t length,
+                                   const DecompressOptions& options, const SizeLimits& limits) {
+        const std::vector<SeekEntry> entries = readSeekTable(src, srcSize, limits);
+        const size_t contentSize = entries.empty() ? 0 :
+            entries.back().decompressedOffset + entries.back().decompressedSize;
+        if (offset > contentSize) {
+            throw std::runtime_error("Offset " + std::to_string(offset) +
+                                     " is outside the content of " + std::to_string(contentSize) + " bytes");
+        }
+        const size_t end = offset + std::min(length, contentSize - offset);
+        validateSize(end - offset, limits.maxOutput, "Output");
+
+        OutputBuffer out(end - offset);
+        out.setSize(end - offset);
+        if (offset == end) {
+            return out;
+        }
+
+        // First frame that ends after offset
+        auto it = std::upper_bound(entries.begin(), entries.end(), offset,
+            [](size_t value, const SeekEntry& entry) {
+                return value < entry.decompressedOffset + entry.decompressedSize;
+            });
+        OutputBuffer scratch;
+        for (; it != entries.end() && it->decompressedOffset < end; ++it) {
+            const size_t frameEnd = it->decompressedOffset + it->decompressedSize;
+            const size_t from = std::max(offset, it->decompressedOffset);
+            const size_t to = std::min(end, frameEnd);
+            uint8_t* target = out.data() + (from - offset);
+            const bool whole = from == it->decompressedOffset && to == frameEnd;
+            // The table is untrusted; a frame header that records its size
+            // must agree with it before anything is allocated for the frame
+            const unsigned long long frameSize = ZSTD_getFrameContentSize(src + it->compressedOffset,
+                                                                          it->compressedSize);
+            if (frameSize != ZSTD_CONTENTSIZE_UNKNOWN && frameSize != it->decompressedSize) {
+                throw std::runtime_error("Invalid seekable data: Frame size does not match the seek table");
+            }
+            if (!whole && scratch.capacity() < it->decompressedSize) {
+                scratch = OutputBuffer(it->decompressedSize);
+            }
+
+            const size_t size = decompressTo(dctx, whole ? target : scratch.data(), it->decompressedSize,
+                                             src + it->compressedOffset, it->compressedSize, options);
+            if (size != it->decompressedSize) {
+                throw std::runtime_error("Invalid seekable data: Frame size does not match the seek table");
+            }
+            if (!whole) {
+                std::memcpy(target, scratch.data() + (from - it->decompressedOffset), to - from);
+            }
+        }
+        return out;
+    }
+
+    // Priority classes of the addon's own thread pool
+    enum JobPriority {
+        PRIORITY_LATENCY, // small inputs, run ahead of bulk work
+        PRIORITY_BULK,
+        PRIORITY_CLASSES
+    };
+
+    constexpr size_t DEFAULT_LATENCY_JOB_SIZE = 64 * 1024;
+    constexpr size_t MAX_POOL_THREADS = 256;
+
+    // Completion path from the pool to one environment's main thread. Pool
+    // threads hand finished workers over in done and wake the main thread
+    // through tsfn, so no worker lives only in the threadsafe function's
+    // queue. The environment's cleanup hook closes the channel, takes back
+    // the jobs still queued, waits for the running ones and destroys every
+    // worker it could not complete, without calling into JS.
+    struct PoolChannel {
+        std::mutex mutex;
+        std::condition_variable idle;
+        bool open = false;
+        Napi::ThreadSafeFunction tsfn;
+        // Jobs not yet completed; the loop is kept alive while there are any
+        size_t pending = 0;
+        // Jobs handed to the pool that have not come back from it
+        size_t running = 0;
+        // Finished, to be completed on the main thread
+        std::vector<Napi::AsyncWorker*> done;
+        // Finished after the channel closed or failed to wake the main thread
+        std::vector<Napi::AsyncWorker*> orphans;
+
+        // Main thread: completes the finished workers
+        void deliver(Napi::Env env) {
+            std::vector<Napi::AsyncWorker*> workers;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                workers.swap(done);
+                pending -= workers.size();
+                if (pending == 0 && !workers.empty()) {
+                    tsfn.Unref(env);
+                }
+            }
+            for (Napi::AsyncWorker* worker : workers) {
+                worker->OnWorkComplete(env, napi_ok);
+            }
+        }
+    };
+    using PoolChannelPtr = std::shared_ptr<PoolChannel>;
+
+    // Per environment, from the addon instance data
+    PoolChannelPtr poolChannel(Napi::Env env);
+
+    // Native threads that run the addon's AsyncWorkers once
+    // configureThreadPool() is called, instead of the libuv threadpool that
+    // fs and dns share. Each thread owns a deque per priority class. Jobs are
+    // handed out round-robin; a thread takes the front of its own deque and
+    // otherwise steals from the back of another thread's. Latency jobs go
+    // first, and the first latencyThreads threads take nothing else, so a
+    // small job never waits behind a thread full of bulk work.
+    // Counts per class are claimed under one mutex before a deque is
+    // searched, so a woken thread always finds the job it was woken for.
+    class ThreadPool {
+    public:
+        struct Job {
+            Napi::AsyncWorker* worker;
+            PoolChannelPtr channel;
+            JobPriority priority;
+        };
+
+        struct Config {
+            size_t threads = 0;
+            size_t latencyThreads = 0;
+            size_t latencyJobSize = DEFAULT_LATENCY_JOB_SIZE;
+            std::vector<unsigned> affinity; // CPU of thread i: affinity[i % size]
+        };
+
+        // Any environment's main thread; threads == 0 returns the work to
+        // the libuv threadpool. Only possible while no job is queued or running.
+        void configure(Config config) {
+            std::lock_guard<std::mutex> configuring(configureMutex_);
+            {
+                std::lock_guard<std::mutex> lock(idleMutex_);
+                if (queued_[PRIORITY_LATENCY] + queued_[PRIORITY_BULK] + running_ > 0) {
+                    throw std::runtime_error("Thread pool is busy; configure it while no jobs are queued");
+                }
+                stopping_ = true;
+                accepting_ = false;
+            }
+            idle_.notify_all();
+            for (auto& thread : threads_) {
+                thread->thread.join();
+            }
+            threads_.clear();
+
+            {
+                std::lock_guard<std::mutex> lock(idleMutex_);
+                stopping_ = false;
+                config_ = config;
+            }
+            for (size_t i = 0; i < config.threads; i++) {
+                threads_.push_back(std::make_unique<Thread>());
+            }
+            for (size_t i = 0; i < config.threads; i++) {
+                threads_[i]->thread = std::thread([this, i] { run(i); });
+                if (!config.affinity.empty()) {
+                    pin(threads_[i]->thread, config.affinity[i % config.affinity.size()]);
+                }
+            }
+            std::lock_guard<std::mutex> lock(idleMutex_);
+            accepting_ = config.threads > 0;
+        }
+
+        bool accepting() {
+            std::lock_guard<std::mutex> lock(idleMutex_);
+            return accepting_;
+        }
+
+        // Main thread. False when the pool is not running, and the caller
+        // queues on the libuv threadpool instead.
+        bool submit(Job job, size_t bytes) {
+            std::lock_guard<std::mutex> lock(idleMutex_);
+            if (!accepting_) {
+                return false;
+            }
+            job.priority = bytes <= config_.latencyJobSize ? PRIORITY_LATENCY : PRIORITY_BULK;
+            // Bulk jobs start out on the threads that may run them
+            const size_t first = job.priority == PRIORITY_BULK && config_.latencyThreads < threads_.size() ?
+                config_.latencyThreads : 0;
+            Thread& target = *threads_[first + next_++ % (threads_.size() - first)];
+            const JobPriority priority = job.priority;
+            {
+                std::lock_guard<std::mutex> deque(target.mutex);
+                target.jobs[priority].push_back(std::move(job));
+            }
+            queued_[priority]++;
+            idle_.notify_all();
+            return true;
+        }
+
+        // Main thread of the channel's environment, at teardown: takes its
+        // jobs that have not started back out of the queues. Jobs another
+        // thread has already claimed are left to run.
+        std::vector<Napi::AsyncWorker*> drop(const PoolChannelPtr& channel) {
+            std::vector<Napi::AsyncWorker*> dropped;
+            std::lock_guard<std::mutex> lock(idleMutex_);
+            for (auto& thread : threads_) {
+                std::lock_guard<std::mutex> deque(thread->mutex);
+                for (int priority = 0; priority < PRIORITY_CLASSES; priority++) {
+                    auto& jobs = thread->jobs[priority];
+                    for (auto it = jobs.begin(); it != jobs.end() && queued_[priority] > 0;) {
+                        if (it->channel == channel) {
+                            dropped.push_back(it->worker);
+                            queued_[priority]--;
+                            it = jobs.erase(it);
+                        } else {
+                            ++it;
+                        }
+                    }
+                }
+            }
+            return dropped;
+        }
+
+        // { threads, latencyThreads, latencyJobSize, queued, running, completed, steals }
+        Napi::Object stats(Napi::Env env) {
+            const auto number = [&](uint64_t value) { return Napi::Number::New(env, static_cast<double>(value)); };
+            const auto perClass = [&](const uint64_t (&values)[PRIORITY_CLASSES]) {
+                auto object = Napi::Object::New(env);
+                object.Set("latency", number(values[PRIORITY_LATENCY]));
+                object.Set("bulk", number(values[PRIORITY_BULK]));
+                return object;
+            };
+            std::lock_guard<std::mutex> lock(idleMutex_);
+            auto result = Napi::Object::New(env);
+            result.Set("threads", number(threads_.size()));
+            result.Set("latencyThreads", number(threads_.empty() ? 0 : config_.latencyThreads));
+            result.Set("latencyJobSize", number(config_.latencyJobSize));
+            result.Set("queued", perClass(queued_));
+            result.Set("running", number(running_));
+            result.Set("completed", perClass(completed_));
+            result.Set("steals", number(steals_.load()));
+            return result;
+        }
+
+    private:
+        struct Thread {
+            std::mutex mutex;
+            std::deque<Job> jobs[PRIORITY_CLASSES];
+            std::thread thread;
+        };
+
+        static void pin(std::thread& thread, unsigned cpu) {
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+            (void)thread;
+            (void)cpu;
+#endif
+        }
+
+        void run(size_t index) {
+            const bool latencyOnly = index < config_.latencyThreads;
+            for (;;) {
+                JobPriority priority;
+                {
+                    std::unique_lock<std::mutex> lock(idleMutex_);
+                    idle_.wait(lock, [&] {
+                        return stopping_ || queued_[PRIORITY_LATENCY] > 0 ||
+                               (!latencyOnly && queued_[PRIORITY_BULK] > 0);
+                    });
+                    if (queued_[PRIORITY_LATENCY] > 0) {
+                        priority = PRIORITY_LATENCY;
+                    } else if (!latencyOnly && queued_[PRIORITY_BULK] > 0) {
+                        priority = PRIORITY_BULK;
+                    } else {
+                        return;
+                    }
+                    queued_[priority]--;
+                    running_++;
+                }
+
+                Job job = take(index, priority);
+                job.worker->OnExecute(job.worker->Env());
+                // Counted before the hand-over, after which the worker may
+                // be destroyed and its environment gone
+                {
+                    std::lock_guard<std::mutex> lock(idleMutex_);
+                    running_--;
+                    completed_[priority]++;
+                }
+                complete(std::move(job));
+            }
+        }
+
+        // A job of the claimed class: there is one in some deque
+        Job take(size_t index, JobPriority priority) {
+            for (;;) {
+                for (size_t i = 0; i < threads_.size(); i++) {
+                    Thread& thread = *threads_[(index + i) % threads_.size()];
+                    std::lock_guard<std::mutex> lock(thread.mutex);
+                    auto& jobs = thread.jobs[priority];
+                    if (jobs.empty()) {
+                        continue;
+                    }
+                    Job job;
+                    if (i == 0) {
+                        job = std::move(jobs.front());
+                        jobs.pop_front();
+                    } else {
+                        job = std::move(jobs.back());
+                        jobs.pop_back();
+                        steals_++;
+                    }
+                    return job;
+                }
+                std::this_thread::yield();
+            }
+        }
+
+        static void complete(Job job) {
+            PoolChannelPtr channel = std::move(job.channel);
+            std::lock_guard<std::mutex> lock(channel->mutex);
+            channel->running--;
+            bool delivered = false;
+            if (channel->open) {
+                channel->done.push_back(job.worker);
+                const napi_status status = channel->tsfn.NonBlockingCall([channel](Napi::Env env, Napi::Function) {
+                    channel->deliver(env);
+                });
+                delivered = status == napi_ok;
+                if (!delivered) {
+                    channel->done.pop_back();
+                }
+            }
+            if (!delivered) {
+                // Left for the cleanup hook, which destroys it on the main thread
+                channel->pending--;
+                channel->orphans.push_back(job.worker);
+            }
+            channel->idle.notify_all();
+        }
+
+        std::mutex configureMutex_;
+        std::mutex idleMutex_;
+        std::condition_variable idle_;
+        std::vector<std::unique_ptr<Thread>> threads_;
+        Config config_;
+        bool stopping_ = false;
+        bool accepting_ = false;
+        size_t next_ = 0;
+        uint64_t queued_[PRIORITY_CLASSES] = {};
+        uint64_t running_ = 0;
+        uint64_t completed_[PRIORITY_CLASSES] = {};
+        // Counted under a deque's mutex, which nests inside idleMutex_
+        std::atomic<uint64_t> steals_{0};
+    };
+
+    // Leaked like the other process-wide state, so exit never joins threads
+    ThreadPool& threadPool() {
+        static ThreadPool* pool = new ThreadPool();
+        return *pool;
+    }
+
+    // Queues worker, which reads about bytes of input, on the addon's thread
+    // pool when one is configured and on the libuv threadpool otherwise.
+    // SIZE_MAX marks work of unknown size, which is bulk.
+    void queueWork(Napi::AsyncWorker* worker, size_t bytes) {
+        if (!threadPool().accepting()) {
+            worker->Queue();
+            return;
+        }
+        Napi::Env env = worker->Env();
+        PoolChannelPtr channel = poolChannel(env);
+        // Counted first: the job may finish before submit() returns
+        {
+            std::lock_guard<std::mutex> lock(channel->mutex);
+            if (channel->pending++ == 0) {
+                channel->tsfn.Ref(env);
+            }
+            channel->running++;
+        }
+        if (threadPool().submit({ worker, channel, PRIORITY_BULK }, bytes)) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(channel->mutex);
+            channel->running--;
+            if (--channel->pending == 0) {
+                channel->tsfn.Unref(env);
+            }
+        }
+        worker->Queue();
+    }
+
+    // Base for the Promise-returning entry points: runs Execute() on a worker
+    // thread (see queueWork) and settles a deferred on the main thread. The input Buffer is
+    // kept referenced until the worker completes.
+    // Keeps an ObjectWrap owner alive and flagged busy while a worker uses its
+    // context, which must not be used concurrently.
+    class OwnerLease {
+    public:
+        void acquire(Napi::Object owner, bool& busy) {
+            ref_ = Napi::Persistent(owner);
+            busy_ = &busy;
+            busy = true;
+        }
+
+        void release() {
+            if (busy_) {
+                *busy_ = false;
+                busy_ = nullptr;
+            }
+        }
+
+    private:
+        Napi::ObjectReference ref_;
+        bool* busy_ = nullptr;
+    };
+
+    class BufferWorker : public Napi::AsyncWorker {
+    public:
+        Napi::Promise Promise() const { return deferred_.Promise(); }
+
+        // Used by Compressor/Decompressor to pin their own context to this job
+        void Lease(Napi::Object owner, bool& busy) {
+            lease_.acquire(owner, busy);
+        }
+
+        // Keeps a second input (a delta base) referenced until completion
+        void Retain(const InputBytes& input) {
+            retainedRef_ = Napi::Persistent(input.object);
+        }
+
+        // Follows the call's AbortSignal until the worker settles
+        void Watch(const CancellationPtr& cancel) {
+            if (cancel) {
+                cancel_ = cancel;
+                cancel_->listen(Env());
+            }
+        }
+
+    protected:
+        BufferWorker(Napi::Env env, const char* name, const InputBytes& input)
+            : Napi::AsyncWorker(env, name),
+              deferred_(Napi::Promise::Deferred::New(env)),
+              inputRef_(Napi::Persistent(input.object)),
+              src_(input.Data()),
+              srcSize_(input.Length()) {}
+
+        void OnOK() override {
+            lease_.release();
+            if (cancel_) {
+                cancel_->release();
+            }
+            deferred_.Resolve(result(Env()));
+        }
+
+        // What the Promise resolves to: the output Buffer by default
+        virtual Napi::Value result(Napi::Env env) {
+            return out_.toBuffer(env);
+        }
+
+        void OnError(const Napi::Error& e) override {
+            lease_.release();
+            if (cancel_) {
+                cancel_->decorate(e);
+                cancel_->release();
+            }
+            deferred_.Reject(e.Value());
+        }
+
+        Napi::Promise::Deferred deferred_;
+        Napi::ObjectReference inputRef_;
+        Napi::ObjectReference retainedRef_;
+        OwnerLease lease_;
+        CancellationPtr cancel_;
+        QueueToken queued_;
+        const uint8_t* src_;
+        size_t srcSize_;
+        OutputBuffer out_;
+    };
+
+    class CompressWorker : public BufferWorker {
+    public:
+        // A null context means the executing thread's pooled context is used.
+        CompressWorker(Napi::Env env, const InputBytes& input, CompressOptions options,
+                       const SizeLimits& limits, CompressionContext* context = nullptr)
+            : BufferWorker(env, "zstdCompress", input), options_(std::move(options)),
+              limits_(limits), context_(context) {
+            Watch(options_.cancel);
+        }
+
+    protected:
+        void Execute() override {
+            try {
+                out_ = compressData(context_ ? *context_ : threadCCtx(), src_, srcSize_, options_, limits_);
+            } catch (const std::exception& e) {
+                SetError(e.what());
+            }
+        }
+
+    private:
+        CompressOptions options_;
+        SizeLimits limits_;
+        CompressionContext* context_;
+    };
+
+    class DecompressWorker : public BufferWorker {
+    public:
+        // A null dctx means the executing thread's pooled context is used.
+        DecompressWorker(Napi::Env env, const InputBytes& input, DecompressOptions options,
+                         const SizeLimits& limits, ZSTD_DCtx* dctx = nullptr)
+            : BufferWorker(env, "zstdDecompress", input), options_(std::move(options)),
+              limits_(limits), dctx_(dctx), digest_(options_.digest) {
+            Watch(options_.cancel);
+        }
+
+    protected:
+        void Execute() override {
+            try {
+                out_ = decompressData(dctx_ ? dctx_ : threadDCtx(), src_, srcSize_, options_, limits_,
+                                      digest_ ? &digest_ : nullptr);
+            } catch (const std::exception& e) {
+                SetError(e.what());
+            }
+        }
+
+        Napi::Value result(Napi::Env env) override {
+            return withDigest(env, out_.toBuffer(env), digest_);
+        }
+
+    private:
+        DecompressOptions options_;
+        SizeLimits limits_;
+        ZSTD_DCtx* dctx_;
+        Digest digest_;
+    };
+
+    class ReadRangeWorker : public BufferWorker {
+    public:
+        ReadRangeWorker(Napi::Env env, const InputBytes& input, size_t offset, size_t length,
+                        DecompressOptions options, const SizeLimits& limits)
+            : BufferWorker(env, "zstdReadRange", input), offset_(offset), length_(length),
+              options_(std::move(options)), limits_(limits) {}
+
+    protected:
+        void Execute() override {
+            try {
+                out_ = readSeekableRange(threadDCtx(), src_, srcSize_, offset_, length_, options_, limits_);
+            } catch (const std::exception& e) {
+                SetError(e.what());
+            }
+        }
+
+    private:
+        size_t offset_;
+        size_t length_;
+        DecompressOptions options_;
+        SizeLimits limits_;
+    };
+
+    // { frameSize } from a compressSeekable options object
+    inline size_t getFrameSize(const Napi::CallbackInfo& info, size_t index) {
+        if (info.Length() <= index || !info[index].IsObject()) {
+            return DEFAULT_SEEKABLE_FRAME_SIZE;
+        }
+        const size_t frameSize = getUnsignedOption(info[index].As<Napi::Object>(), "frameSize",
+                                                   DEFAULT_SEEKABLE_FRAME_SIZE, SEEKABLE_MAX_FRAME_SIZE);
+        if (frameSize == 0) {
+            throw std::runtime_error("Option frameSize must be at least 1");
+        }
+        return frameSize;
+    }
+
+    // The (offset, length) arguments of readRange; length defaults to the rest
+    struct ByteRange {
+        size_t offset;
+        size_t length;
+    };
+
+    inline ByteRange getRange(const Napi::CallbackInfo& info, size_t index) {
+        if (info.Length() <= index || !info[index].IsNumber()) {
+            throw std::runtime_error("Offset must be a number");
+        }
+        ByteRange range = { safeConvertToSizeT(info[index].As<Napi::Number>().Int64Value(), "Offset"), SIZE_MAX };
+        if (info.Length() > index + 1 && !info[index + 1].IsUndefined()) {
+            if (!info[index + 1].IsNumber()) {
+                throw std::runtime_error("Length must be a number");
+            }
+            range.length = safeConvertToSizeT(info[index + 1].As<Napi::Number>().Int64Value(), "Length");
+        }
+        return range;
+    }
+    // Result of one streaming step: at most one output window of data, the
+    // new input offset, and whether the caller may move on to the next chunk.
+    struct StreamStep {
+        OutputBuffer output;
+        size_t consumed = 0;
+        bool done = false;
+    };
+
+    inline size_t validateWindowSize(size_t size, size_t fallback) {
+        if (size == 0) {
+            return fallback;
+        }
+        if (size < 64 || size > (64U << 20)) {
+            throw std::runtime_error("Chunk size must be between 64 bytes and 64MB");
+        }
+        return size;
+    }
+
+    // Incremental compressor over ZSTD_compressStream2. Each step fills at most
+    // one fixed-size output window, so memory stays bounded whatever the
+    // payload size.
+    class StreamCompressor {
+    public:
+        // A known pledgedSize is written into the frame header and lets
+        // { workers: 'auto' } size the pool.
+        StreamCompressor(const CompressOptions& options, size_t windowSize,
+                         unsigned long long pledgedSize = ZSTD_CONTENTSIZE_UNKNOWN)
+            : cctx_(createCCtx()),
+              windowSize_(validateWindowSize(windowSize, ZSTD_CStreamOutSize())),
+              dictionary_(options.dictionary),
+              adapt_(options.adapt),
+              level_(options.currentLevel()),
+              multithreaded_(options.workersFor(pledgedSize) > 0),
+              pledged_(pledgedSize != ZSTD_CONTENTSIZE_UNKNOWN) {
+            memory_.reserve(estimateCompressMemory(options, pledgedSize, level_, true));
+            applyCompressParameters(cctx_.get(), options, pledgedSize, level_);
+            if (pledged_) {
+                checkParameter(ZSTD_CCtx_setPledgedSrcSize(cctx_.get(), pledgedSize), "pledged size");
+            }
+        }
+
+        size_t windowSize() const { return windowSize_; }
+
+        StreamStep step(const uint8_t* src, size_t srcSize, size_t offset, ZSTD_EndDirective mode) {
+            StreamStep step;
+            step.output = OutputBuffer(windowSize_);
+            ZSTD_inBuffer in = { src, srcSize, offset };
+            ZSTD_outBuffer out = { step.output.data(), windowSize_, 0 };
+            step.done = stepInto(in, out, mode);
+            step.consumed = in.pos;
+            step.output.setSize(out.pos);
+            step.output.shrinkToFit();
+            return step;
+        }
+
+        // Compresses until out is full or the input (and, for flush/end, the
+        // context) is drained; returns true in the latter case.
+        bool stepInto(ZSTD_inBuffer& in, ZSTD_outBuffer& out, ZSTD_EndDirective mode) {
+            const CodecTimer timer(true);
+            const size_t inStart = in.pos;
+            const size_t outStart = out.pos;
+            if (adapt_ && mode != ZSTD_e_end && !followLevel(out)) {
+                return false;
+            }
+            for (;;) {
+                const size_t remaining = ZSTD_compressStream2(cctx_.get(), &out, &in, mode);
+                if (ZSTD_isError(remaining)) {
+                    throw std::runtime_error(std::string("Compression failed: ") + ZSTD_getErrorName(remaining));
+                }
+                const bool inputDone = in.pos == in.size;
+                const bool done = inputDone && (mode == ZSTD_e_continue || remaining == 0);
+                if (done || out.pos == out.size) {
+                    frameOpen_ = !(done && mode == ZSTD_e_end);
+                    const size_t consumed = in.pos - inStart;
+                    const uint64_t nanos = timer.record(consumed, out.pos - outStart);
+                    if (adapt_) {
+                        adapt_->observe(consumed, nanos);
+                    }
+                    return done;
+                }
+            }
+        }
+
+    private:
+        // Moves the context to the controller's level. Multithreaded contexts
+        // take a new level for their next job; single-threaded ones (and
+        // dictionary ones, whose CDict is fixed per frame) only when a frame
+        // starts, so the open frame is ended first and the stream continues
+        // with a new one. A pledged frame keeps its level. Returns false if
+        // out filled up before the frame was ended.
+        bool followLevel(ZSTD_outBuffer& out) {
+            const int level = adapt_->level();
+            if (level == level_) {
+                return true;
+            }
+            const bool restart = frameOpen_ && (!multithreaded_ || dictionary_);
+            if (restart && pledged_) {
+                return true;
+            }
+            if (restart) {
+                ZSTD_inBuffer none = { nullptr, 0, 0 };
+                for (;;) {
+                    const size_t remaining = ZSTD_compressStream2(cctx_.get(), &out, &none, ZSTD_e_end);
+                    if (ZSTD_isError(remaining)) {
+                        throw std::runtime_error(std::string("Compression failed: ") + ZSTD_getErrorName(remaining));
+                    }
+                    if (remaining == 0) {
+                        break;
+                    }
+                    if (out.pos == out.size) {
+                        return false;
+                    }
+                }
+                frameOpen_ = false;
+            }
+            checkParameter(ZSTD_CCtx_setParameter(cctx_.get(), ZSTD_c_compressionLevel, level), "level");
+            if (dictionary_) {
+                checkParameter(ZSTD_CCtx_refCDict(cctx_.get(), dictionary_->cdict(level)), "dictionary");
+            }
+            level_ = level;
+            return true;
+        }
+
+        CCtxPtr cctx_;
+        size_t windowSize_;
+        DictionaryPtr dictionary_;
+        std::shared_ptr<AdaptiveLevel> adapt_;
+        int level_;
+        bool multithreaded_;
+        bool pledged_;
+        // A frame has been started and not yet ended
+        bool frameOpen_ = false;
+        MemoryCharge memory_{ MEMORY_CONTEXTS };
+    };
+
+    // Incremental decompressor over ZSTD_decompressStream. Handles frames of
+    // unknown content size and concatenated frames.
+    class StreamDecompressor {
+    public:
+        StreamDecompressor(const DecompressOptions& options, size_t windowSize)
+            : dctx_(createDCtx()),
+              windowSize_(validateWindowSize(windowSize, ZSTD_DStreamOutSize())),
+              dictionary_(options.dictionary) {
+            if (dictionary_) {
+                const size_t result = ZSTD_DCtx_refDDict(dctx_.get(), dictionary_->ddict());
+                if (ZSTD_isError(result)) {
+                    throw std::runtime_error(std::string("Failed to set up decompression stream: ") + ZSTD_getErrorName(result));
+                }
+            }
+            applyChecksumMode(dctx_.get(), options);
+        }
+
+        size_t windowSize() const { return windowSize_; }
+
+        StreamStep step(const uint8_t* src, size_t srcSize, size_t offset, ZSTD_EndDirective mode) {
+            StreamStep step;
+            step.output = OutputBuffer(windowSize_);
+            ZSTD_inBuffer in = { src, srcSize, offset };
+            ZSTD_outBuffer out = { step.output.data(), windowSize_, 0 };
+            step.done = stepInto(in, out, mode);
+            step.consumed = in.pos;
+            step.output.setSize(out.pos);
+            step.output.shrinkToFit();
+            return step;
+        }
+
+        // Decompresses until out is full or the input is exhausted; returns
+        // true when the input is exhausted with room to spare, i.e. nothing
+        // decoded is left buffered in the context.
+        bool stepInto(ZSTD_inBuffer& in, ZSTD_outBuffer& out, ZSTD_EndDirective mode) {
+            // The buffers depend on the window of the first frame
+            if (buffers_.bytes() == 0 && in.pos < in.size) {
+                const size_t streamSize = ZSTD_estimateDStreamSize_fromFrame(
+                    static_cast<const uint8_t*>(in.src) + in.pos, in.size - in.pos);
+                if (!ZSTD_isError(streamSize)) {
+                    buffers_.reserve(streamSize - std::min(streamSize, ZSTD_estimateDCtxSize()));
+                }
+            }
+            const CodecTimer timer(false);
+            const size_t inStart = in.pos;
+            const size_t outStart = out.pos;
+            for (;;) {
+                const size_t inBefore = in.pos;
+                const size_t outBefore = out.pos;
+                const size_t hint = ZSTD_decompressStream(dctx_.get(), &out, &in);
+                if (ZSTD_isError(hint)) {
+                    throw std::runtime_error(std::string("Decompression failed: ") + ZSTD_getErrorName(hint));
+                }
+                // Zero means a frame was fully decoded and flushed. A call that
+                // made no progress says nothing about the frame state.
+                if (in.pos != inBefore || out.pos != outBefore) {
+                    frameComplete_ = hint == 0;
+                }
+                if (out.pos == out.size || in.pos == in.size) {
+                    break;
+                }
+            }
+            timer.record(in.pos - inStart, out.pos - outStart);
+
+            // A full window may leave decoded data buffered in the context
+            const bool done = in.pos == in.size && out.pos < out.size;
+            if (done && mode == ZSTD_e_end && !frameComplete_) {
+                throw std::runtime_error("Decompression failed: Truncated zstd stream");
+            }
+            return done;
+        }
+
+    private:
+        DCtxPtr dctx_;
+        size_t windowSize_;
+        DictionaryPtr dictionary_;
+        // Nothing read yet counts as a complete (empty) stream
+        bool frameComplete_ = true;
+        MemoryCharge buffers_{ MEMORY_CONTEXTS };
+    };
+
+    [[noreturn]] inline void throwFileError(const char* what, const std::string& path) {
+        throw std::runtime_error(std::string(what) + " '" + path + "': " + std::strerror(errno));
+    }
+
+    // Block size for file reads and for the output window written per
+    // write(); large enough that the copy loop stays disk-bound
+    constexpr size_t FILE_BLOCK_SIZE = 1ULL << 20;
+
+    // Source file for compressFile/decompressFile. Regular files are mapped
+    // read-only and handed to the codec in one piece; pipes, devices and
+    // anything mmap refuses are read in FILE_BLOCK_SIZE blocks instead.
+    class InputFile {
+    public:
+        explicit InputFile(const std::string& path) : path_(path) {
+            fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd_ < 0) {
+                throwFileError("Cannot open", path);
+            }
+            if (::fstat(fd_, &stat_) != 0) {
+                const int error = errno;
+                ::close(fd_);
+                errno = error;
+                throwFileError("Cannot stat", path);
+            }
+            if (S_ISREG(stat_.st_mode) && stat_.st_size > 0) {
+                void* map = ::mmap(nullptr, static_cast<size_t>(stat_.st_size), PROT_READ, MAP_PRIVATE, fd_, 0);
+                if (map != MAP_FAILED) {
+                    ::madvise(map, static_cast<size_t>(stat_.st_size), MADV_SEQUENTIAL);
+                    map_ = static_cast<const uint8_t*>(map);
+                }
+            }
+        }
+
+        ~InputFile() {
+            if (map_) {
+                ::munmap(const_cast<uint8_t*>(map_), size());
+            }
+            ::close(fd_);
+        }
+
+        InputFile(const InputFile&) = delete;
+        InputFile& operator=(const InputFile&) = delete;
+
+        const struct stat& stat() const { return stat_; }
+        const uint8_t* mapped() const { return map_; }
+        size_t size() const { return static_cast<size_t>(stat_.st_size); }
+
+        // Size to pledge to the compressor, when the file has a fixed one
+        unsigned long long knownSize() const {
+            return S_ISREG(stat_.st_mode) ? static_cast<unsigned long long>(stat_.st_size) : ZSTD_CONTENTSIZE_UNKNOWN;
+        }
+
+        // Reads up to capacity bytes; 0 means end of file
+        size_t read(uint8_t* data, size_t capacity) {
+            for (;;) {
+                const ssize_t count = ::read(fd_, data, capacity);
+                if (count >= 0) {
+                    return static_cast<size_t>(count);
+                }
+                if (errno != EINTR) {
+                    throwFileError("Cannot read", path_);
+                }
+            }
+        }
+
+    private:
+        std::string path_;
+        int fd_ = -1;
+        struct stat stat_;
+        const uint8_t* map_ = nullptr;
+    };
+
+    // Destination file. It is created or truncated only after checking it is
+    // not the source, and removed again unless commit() is reached, so a
+    // failed call leaves no partial output behind.
+    class OutputFile {
+    public:
+        OutputFile(const std::string& path, const InputFile& source) : path_(path) {
+            fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0666);
+            if (fd_ < 0) {
+                throwFileError("Cannot open", path);
+            }
+            struct stat info;
+            if (::fstat(fd_, &info) != 0) {
+                const int error = errno;
+                ::close(fd_);
+                errno = error;
+                throwFileError("Cannot stat", path);
+            }
+            if (info.st_dev == source.stat().st_dev && info.st_ino == source.stat().st_ino) {
+                ::close(fd_);
+                throw std::runtime_error("Source and destination are the same file '" + path + "'");
+            }
+            // Only regular files are truncated or removed; devices and pipes are written as they are
+            regular_ = S_ISREG(info.st_mode);
+            if (regular_ && ::ftruncate(fd_, 0) != 0) {
+                const int error = errno;
+                discard();
+                errno = error;
+                throwFileError("Cannot truncate", path);
+            }
+        }
+
+        ~OutputFile() {
+            if (fd_ >= 0) {
+                discard();
+            }
+        }
+
+        OutputFile(const OutputFile&) = delete;
+        OutputFile& operator=(const OutputFile&) = delete;
+
+        void write(const uint8_t* data, size_t size) {
+            while (size > 0) {
+                const ssize_t count = ::write(fd_, data, size);
+                if (count < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throwFileError("Cannot write", path_);
+                }
+                data += count;
+                size -= static_cast<size_t>(count);
+                written_ += static_cast<size_t>(count);
+            }
+        }
+
+        size_t written() const { return written_; }
+
+        void commit() {
+            const int result = ::close(fd_);
+            fd_ = -1;
+            if (result != 0) {
+                const int error = errno;
+                if (regular_) {
+                    ::unlink(path_.c_str());
+                }
+                errno = error;
+                throwFileError("Cannot write", path_);
+            }
+        }
+
+    private:
+        void discard() {
+            ::close(fd_);
+            fd_ = -1;
+            if (regular_) {
+                ::unlink(path_.c_str());
+            }
+        }
+
+        std::string path_;
+        int fd_ = -1;
+        bool regular_ = false;
+        size_t written_ = 0;
+    };
+
+    inline StreamCompressor openFileStream(const CompressOptions& options, size_t windowSize,
+                                           const InputFile& input) {
+        return StreamCompressor(options, windowSize, input.knownSize());
+    }
+
+    inline StreamDecompressor openFileStream(const DecompressOptions& options, size_t windowSize,
+                                             const InputFile&) {
+        return StreamDecompressor(options, windowSize);
+    }
+
+    struct FileResult {
+        size_t bytesRead = 0;
+        size_t bytesWritten = 0;
+        // Of what was written to dst
+        Digest digest;
+    };
+
+    // Runs src through a streaming codec into dst on the calling thread.
+    // Output goes through one reused window, so memory stays at one window
+    // plus, for unmapped input, one read block.
+    template <typename Options>
+    FileResult transformFile(const std::string& srcPath, const std::string& dstPath,
+                             const Options& options, size_t windowSize) {
+        InputFile input(srcPath);
+        auto stream = openFileStream(options, windowSize, input);
+        OutputFile output(dstPath, input);
+        OutputBuffer window(stream.windowSize());
+        FileResult result;
+        result.digest = Digest(options.digest);
+
+        const auto drain = [&](const uint8_t* data, size_t size, ZSTD_EndDirective mode) {
+            ZSTD_inBuffer in = { data, size, 0 };
+            bool done = false;
+            while (!done) {
+                checkCancelled(options.cancel);
+                // Cancellable calls expose their input one step at a time
+                in.size = options.cancel ? std::min(size, in.pos + CANCEL_COMPRESS_STEP) : size;
+                const bool last = in.size == size;
+                ZSTD_outBuffer out = { window.data(), window.capacity(), 0 };
+                done = stream.stepInto(in, out, last ? mode : ZSTD_e_continue) && last;
+                result.digest.update(window.data(), out.pos);
+                output.write(window.data(), out.pos);
+            }
+            result.bytesRead += size;
+        };
+
+        if (input.mapped()) {
+            drain(input.mapped(), input.size(), ZSTD_e_end);
+        } else {
+            OutputBuffer block(FILE_BLOCK_SIZE);
+            for (;;) {
+                const size_t count = input.read(block.data(), block.capacity());
+                if (count == 0) {
+                    drain(nullptr, 0, ZSTD_e_end);
+                    break;
+                }
+                drain(block.data(), count, ZSTD_e_continue);
+            }
+        }
+
+        result.bytesWritten = output.written();
+        output.commit();
+        return result;
+    }
+
+    // compressFile/decompressFile on the threadpool; resolves to
+    // { bytesRead, bytesWritten[, digest] }
+    template <typename Options>
+    class FileWorker : public Napi::AsyncWorker {
+    public:
+        FileWorker(Napi::Env env, const char* name, std::string src, std::string dst,
+                   Options options, size_t windowSize)
+            : Napi::AsyncWorker(env, name),
+              deferred_(Napi::Promise::Deferred::New(env)),
+              src_(std::move(src)),
+              dst_(std::move(dst)),
+              options_(std::move(options)),
+              windowSize_(windowSize) {
+            if (options_.cancel) {
+                options_.cancel->listen(env);
+            }
+        }
+
+        Napi::Promise Promise() const { return deferred_.Promise(); }
+
+    protected:
+        void Execute() override {
+            try {
+                result_ = transformFile(src_, dst_, options_, windowSize_);
+            } catch (const std::exception& e) {
+                SetError(e.what());
+            }
+        }
+
+        void OnOK() override {
+            Napi::Env env = Env();
+            if (options_.cancel) {
+                options_.cancel->release();
+            }
+            auto object = Napi::Object::New(env);
+            object.Set("bytesRead", Napi::Number::New(env, static_cast<double>(result_.bytesRead)));
+            object.Set("bytesWritten", Napi::Number::New(env, static_cast<double>(result_.bytesWritten)));
+            if (result_.digest) {
+                object.Set("digest", Napi::String::New(env, result_.digest.hex()));
+            }
+            deferred_.Resolve(object);
+        }
+
+        void OnError(const Napi::Error& e) override {
+            if (options_.cancel) {
+                options_.cancel->decorate(e);
+                options_.cancel->release();
+            }
+            deferred_.Reject(e.Value());
+        }
+
+    private:
+        Napi::Promise::Deferred deferred_;
+        std::string src_;
+        std::string dst_;
+        Options options_;
+        size_t windowSize_;
+        FileResult result_;
+        QueueToken queued_;
+    };
+
+    inline std::string getPath(const Napi::CallbackInfo& info, size_t index, const char* name) {
+        if (info.Length() <= index || !info[index].IsString()) {
+            throw std::runtime_error(std::string(name) + " must be a path string");
+        }
+        return info[index].As<Napi::String>().Utf8Value();
+    }
+
+    // { chunkSize } from a file options object: the output window per write
+    inline size_t getFileWindowSize(const Napi::CallbackInfo& info, size_t index) {
+        if (info.Length() <= index || !info[index].IsObject()) {
+            return FILE_BLOCK_SIZE;
+        }
+        return validateWindowSize(getUnsignedOption(info[index].As<Napi::Object>(), "chunkSize", 0, UINT32_MAX),
+                                  FILE_BLOCK_SIZE);
+    }
+
+    inline ZSTD_EndDirective getEndDirective(const Napi::Value& value) {
+        const int mode = value.IsNumber() ? value.As<Napi::Number>().Int32Value() : 0;
+        switch (mode) {
+            case ZSTD_e_continue: return ZSTD_e_continue;
+            case ZSTD_e_flush: return ZSTD_e_flush;
+            case ZSTD_e_end: return ZSTD_e_end;
+            default: throw std::runtime_error("Invalid flush mode " + std::to_string(mode));
+        }
+    }
+
+    // Runs one StreamStep on the threadpool and reports it as
+    // callback(err, output, consumed, done).
+    template <typename Stream>
+    class StreamWorker : public Napi::AsyncWorker {
+    public:
+        StreamWorker(Napi::Function callback, Stream& stream, const InputBytes& chunk,
+                     size_t offset, ZSTD_EndDirective mode)
+            : Napi::AsyncWorker(callback, "zstdStream"),
+              stream_(stream),
+              chunkRef_(Napi::Persistent(chunk.object)),
+              src_(chunk.Data()),
+              srcSize_(chunk.Length()),
+              offset_(offset),
+              mode_(mode) {}
+
+        void Lease(Napi::Object owner, bool& busy) {
+            lease_.acquire(owner, busy);
+        }
+
+    protected:
+        void Execute() override {
+            try {
+                step_ = stream_.step(src_, srcSize_, offset_, mode_);
+            } catch (const std::exception& e) {
+                SetError(e.what());
+            }
+        }
+
+        void OnOK() override {
+            lease_.release();
+            Napi::Env env = Env();
+            Callback().Call({
+                env.Null(),
+                step_.output.toBuffer(env),
+                Napi::Number::New(env, static_cast<double>(step_.consumed)),
+                Napi::Boolean::New(env, step_.done)
+            });
+        }
+
+        void OnError(const Napi::Error& e) override {
+            lease_.release();
+            Callback().Call({ e.Value() });
+        }
+
+    private:
+        Stream& stream_;
+        Napi::ObjectReference chunkRef_;
+        const uint8_t* src_;
+        size_t srcSize_;
+        size_t offset_;
+        ZSTD_EndDirective mode_;
+        StreamStep step_;
+        OwnerLease lease_;
+        QueueToken queued_;
+    };
+    // References the Buffers of a JS array from a private array, so JS cannot
+    // swap them out while a worker reads them, and records their bytes in spans.
+    Napi::ObjectReference pinBuffers(Napi::Env env, Napi::Array buffers, const char* label,
+                                     std::vector<ByteSpan>& spans) {
+        const uint32_t count = buffers.Length();
+        auto pinned = Napi::Array::New(env, count);
+        spans.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            const InputBytes bytes = getInputBytes(buffers.Get(i), std::string(label) + " " + std::to_string(i));
+            pinned.Set(i, bytes.object);
+            spans.push_back(bytes.span);
+        }
+        return Napi::Persistent(pinned.As<Napi::Object>());
+    }
+
+    // Trains a dictionary on the threadpool. The samples are pinned with
+    // pinBuffers() and concatenated into the flat buffer ZDICT expects on the
+    // worker thread.
+    class TrainDictionaryWorker : public Napi::AsyncWorker {
+    public:
+        TrainDictionaryWorker(Napi::Env env, Napi::Array samples, size_t capacity,
+                              bool optimize, const ZDICT_fastCover_params_t& params)
+            : Napi::AsyncWorker(env, "zstdTrainDictionary"),
+              deferred_(Napi::Promise::Deferred::New(env)),
+              limits_(currentLimits(env)),
+              capacity_(capacity),
+              optimize_(optimize),
+              params_(params) {
+            samplesRef_ = pinBuffers(env, samples, "Sample", samples_);
+            for (const ByteSpan& sample : samples_) {
+                totalSize_ += sample.size;
+            }
+        }
+
+        Napi::Promise Promise() const { return deferred_.Promise(); }
+
+    protected:
+        void Execute() override {
+            try {
+                validateSize(totalSize_, limits_.maxInput, "Input");
+
+                OutputBuffer flat(totalSize_);
+                std::vector<size_t> sizes;
+                sizes.reserve(samples_.size());
+                size_t pos = 0;
+                for (const ByteSpan& sample : samples_) {
+                    if (sample.size) {
+                        std::memcpy(flat.data() + pos, sample.data, sample.size);
+                    }
+                    pos += sample.size;
+                    sizes.push_back(sample.size);
+                }
+
+                out_ = OutputBuffer(capacity_);
+                const unsigned count = static_cast<unsigned>(sizes.size());
+                const size_t dictSize = optimize_ ?
+                    ZDICT_optimizeTrainFromBuffer_fastCover(out_.data(), capacity_, flat.data(),
+                                                            sizes.data(), count, &params_) :
+                    ZDICT_trainFromBuffer(out_.data(), capacity_, flat.data(), sizes.data(), count);
+                if (ZDICT_isError(dictSize)) {
+                    throw std::runtime_error(std::string("Dictionary training failed: ") +
+                                             ZDICT_getErrorName(dictSize));
+                }
+                out_.setSize(dictSize);
+                out_.shrinkToFit();
+            } catch (const std::exception& e) {
+                SetError(e.what());
+            }
+        }
+
+        void OnOK() override {
+            deferred_.Resolve(out_.toBuffer(Env()));
+        }
+
+        void OnError(const Napi::Error& e) override {
+            deferred_.Reject(e.Value());
+        }
+
+    private:
+        Napi::Promise::Deferred deferred_;
+        Napi::ObjectReference samplesRef_;
+        std::vector<ByteSpan> samples_;
+        size_t totalSize_ = 0;
+        SizeLimits limits_;
+        size_t capacity_;
+        bool optimize_;
+        ZDICT_fastCover_params_t params_;
+        OutputBuffer out_;
+        QueueToken queued_;
+    };
+
+    inline OutputBuffer batchItem(const ByteSpan& src, const CompressOptions& options,
+                                  const SizeLimits& limits) {
+        return compressData(threadCCtx(), src.data, src.size, options, limits);
+    }
+
+    inline OutputBuffer batchItem(const ByteSpan& src, const DecompressOptions& options,
+                                  const SizeLimits& limits) {
+        return decompressData(threadDCtx(), src.data, src.size, options, limits);
+    }
+
+    // One call split into threadpool jobs, each running a contiguous range
+    // [begin, end) of its items. The last job to leave Execute() calls
+    // finish() unless a range failed; the last to complete on the main thread
+    // settles the Promise with result() or the first error.
+    struct RangeJob {
+        explicit RangeJob(Napi::Env env) : deferred(Napi::Promise::Deferred::New(env)) {}
+        virtual ~RangeJob() = default;
+
+        // Worker thread; index numbers the range in queue order
+        virtual void run(size_t index, size_t begin, size_t end) = 0;
+        virtual void finish() {}
+        // Main thread
+        virtual Napi::Value result(Napi::Env env) = 0;
+        // Input bytes of a range, for queueWork(); unknown by default
+        virtual size_t weight(size_t, size_t) const { return SIZE_MAX; }
+
+        Napi::Promise::Deferred deferred;
+
+        // Jobs still in Execute(), and whether any range failed
+        std::atomic<size_t> executing{0};
+        std::atomic<bool> failed{false};
+
+        // Main thread only: jobs not yet completed, and the first error
+        size_t pending = 0;
+        std::string error;
+
+        // Followed from queueing until the Promise settles
+        CancellationPtr cancel;
+    };
+
+    // State shared by the jobs of one compressBatch/decompressBatch call. The
+    // options and limits are resolved once for the whole batch.
+    template <typename Options>
+    struct BatchJob : RangeJob {
+        BatchJob(Napi::Env env, Options options, bool contiguous)
+            : RangeJob(env),
+              options(std::move(options)),
+              limits(currentLimits(env)),
+              contiguous(contiguous) {}
+
+        // Items are written to disjoint slots, so jobs share no locks
+        void run(size_t, size_t begin, size_t end) override {
+            for (size_t i = begin; i < end && !failed; i++) {
+                try {
+                    outputs[i] = batchItem(inputs[i], options, limits);
+                } catch (const std::exception& e) {
+                    throw std::runtime_error("Item " + std::to_string(i) + ": " + e.what());
+                }
+            }
+        }
+
+        void finish() override {
+            if (contiguous) {
+                join();
+            }
+        }
+
+        size_t weight(size_t begin, size_t end) const override {
+            size_t bytes = 0;
+            for (size_t i = begin; i < end; i++) {
+                bytes += inputs[i].size;
+            }
+            return bytes;
+        }
+
+        // Concatenates the outputs into one block; runs on the worker thread
+        // that finishes last.
+        void join() {
+            size_t total = 0;
+            for (const OutputBuffer& output : outputs) {
+                total += output.size();
+            }
+            validateSize(total, limits.maxOutput, "Batch output");
+
+            joined = OutputBuffer(total);
+            offsets.reserve(outputs.size() + 1);
+            size_t pos = 0;
+            for (OutputBuffer& output : outputs) {
+                offsets.push_back(pos);
+                if (output.size()) {
+                    std::memcpy(joined.data() + pos, output.data(), output.size());
+                }
+                pos += output.size();
+                output = OutputBuffer();
+            }
+            offsets.push_back(pos);
+            joined.setSize(total);
+        }
+
+        // An array of Buffers, or { buffer, offsets } for contiguous output
+        Napi::Value result(Napi::Env env) override {
+            if (!contiguous) {
+                auto array = Napi::Array::New(env, outputs.size());
+                for (size_t i = 0; i < outputs.size(); i++) {
+                    array.Set(static_cast<uint32_t>(i), outputs[i].toBuffer(env));
+                }
+                return array;
+            }
+            auto table = Napi::Array::New(env, offsets.size());
+            for (size_t i = 0; i < offsets.size(); i++) {
+                table.Set(static_cast<uint32_t>(i), Napi::Number::New(env, static_cast<double>(offsets[i])));
+            }
+            auto object = Napi::Object::New(env);
+            object.Set("buffer", joined.toBuffer(env));
+            object.Set("offsets", table);
+            return object;
+        }
+
+        Napi::ObjectReference inputsRef;
+        std::vector<ByteSpan> inputs;
+        std::vector<OutputBuffer> outputs;
+        const Options options;
+        const SizeLimits limits;
+        const bool contiguous;
+        OutputBuffer joined;
+        std::vector<size_t> offsets;
+    };
+
+    // Runs one range of a RangeJob on the threadpool
+    class RangeWorker : public Napi::AsyncWorker {
+    public:
+        RangeWorker(Napi::Env env, const char* name, std::shared_ptr<RangeJob> job,
+                    size_t index, size_t begin, size_t end)
+            : Napi::AsyncWorker(env, name), job_(std::move(job)), index_(index), begin_(begin), end_(end) {}
+
+    protected:
+        void Execute() override {
+            RangeJob& job = *job_;
+            if (!job.failed) {
+                try {
+                    job.run(index_, begin_, end_);
+                } catch (const std::exception& e) {
+                    job.failed = true;
+                    SetError(e.what());
+                }
+            }
+            if (job.executing.fetch_sub(1) == 1 && !job.failed) {
+                try {
+                    job.finish();
+                } catch (const std::exception& e) {
+                    job.failed = true;
+                    SetError(e.what());
+                }
+            }
+        }
+
+        void OnOK() override {
+            Settle();
+        }
+
+        void OnError(const Napi::Error& e) override {
+            if (job_->error.empty()) {
+                job_->error = e.Message();
+            }
+            Settle();
+        }
+
+    private:
+        void Settle() {
+            RangeJob& job = *job_;
+            if (--job.pending > 0) {
+                return;
+            }
+            if (job.error.empty()) {
+                job.deferred.Resolve(job.result(Env()));
+            } else {
+                job.deferred.Reject(callError(Env(), job.error, job.cancel).Value());
+            }
+            if (job.cancel) {
+                job.cancel->release();
+            }
+        }
+
+        std::shared_ptr<RangeJob> job_;
+        size_t index_;
+        size_t begin_;
+        size_t end_;
+        QueueToken queued_;
+    };
+
+    // Splits count items into at most one contiguous range per core, of
+    // roughly equal total weight(i)
+    template <typename Weight>
+    std::vector<std::pair<size_t, size_t>> splitRanges(size_t count, Weight weight) {
+        size_t totalWeight = 0;
+        for (size_t i = 0; i < count; i++) {
+            totalWeight += weight(i);
+        }
+        const size_t jobs = std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency()));
+
+        std::vector<std::pair<size_t, size_t>> ranges;
+        size_t begin = 0;
+        size_t sum = 0;
+        for (size_t i = 0; i < count; i++) {
+            sum += weight(i);
+            const bool last = i + 1 == count;
+            if (last || (ranges.size() + 1 < jobs && sum * jobs >= totalWeight * (ranges.size() + 1))) {
+                ranges.emplace_back(begin, i + 1);
+                begin = i + 1;
+            }
+        }
+        return ranges;
+    }
+
+    // Queues one RangeWorker per range; there must be at least one
+    Napi::Promise queueRanges(Napi::Env env, const char* name, const std::shared_ptr<RangeJob>& job,
+                              const std::vector<std::pair<size_t, size_t>>& ranges) {
+        job->executing = ranges.size();
+        job->pending = ranges.size();
+        for (size_t i = 0; i < ranges.size(); i++) {
+            queueWork(new RangeWorker(env, name, job, i, ranges[i].first, ranges[i].second),
+                      job->weight(ranges[i].first, ranges[i].second));
+        }
+        return job->deferred.Promise();
+    }
+
+    // Fixed cost of an item, in input bytes, when balancing batch jobs; keeps
+    // a run of tiny records from landing in a single job.
+    constexpr size_t BATCH_ITEM_WEIGHT = 512;
+
+    template <typename Options>
+    Napi::Promise queueBatch(Napi::Env env, const char* name, Napi::Array items,
+                             Options options, bool contiguous) {
+        auto job = std::make_shared<BatchJob<Options>>(env, std::move(options), contiguous);
+        job->inputsRef = pinBuffers(env, items, "Item", job->inputs);
+        const size_t count = job->inputs.size();
+        job->outputs.resize(count);
+
+        if (count == 0) {
+            job->finish();
+            job->deferred.Resolve(job->result(env));
+            return job->deferred.Promise();
+        }
+
+        const auto ranges = splitRanges(count, [&](size_t i) { return job->inputs[i].size + BATCH_ITEM_WEIGHT; });
+        job->cancel = job->options.cancel;
+        if (job->cancel) {
+            job->cancel->listen(env);
+        }
+        return queueRanges(env, name, job, ranges);
+    }
+
+    // compressSeekable on the threadpool: each range of frames is compressed
+    // into its own block on its thread's pooled context, and the job that
+    // finishes last appends the other blocks and the seek table to the first.
+    struct SeekableCompressJob : RangeJob {
+        SeekableCompressJob(Napi::Env env, const InputBytes& input, CompressOptions options,
+                            size_t frameSize, const SizeLimits& limits)
+            : RangeJob(env),
+              inputRef(Napi::Persistent(input.object)),
+              options(std::move(options)),
+              layout(input.Data(), input.Length(), frameSize, this->options),
+              limits(limits) {}
+
+        void run(size_t index, size_t begin, size_t end) override {
+            parts[index] = compressSeekableFrames(threadCCtx(), layout, begin, end, options);
+        }
+
+        void finish() override {
+            size_t total = layout.tableSize();
+            for (const SeekableFrames& part : parts) {
+                total += part.data.size();
+            }
+            validateSize(total, limits.maxOutput, "Output");
+
+            std::vector<uint32_t> entries;
+            entries.reserve(layout.frames * 3);
+            out = parts.empty() ? OutputBuffer(total) : std::move(parts[0].data);
+            size_t written = out.size();
+            // Part 0's block is sized by its compress bound and usually holds
+            // everything already; grow() is only for enlarging it
+            if (total > out.capacity()) {
+                out.grow(total);
+            }
+            for (size_t i = 0; i < parts.size(); i++) {
+                if (i > 0 && parts[i].data.size()) {
+                    std::memcpy(out.data() + written, parts[i].data.data(), parts[i].data.size());
+                    written += parts[i].data.size();
+                }
+                entries.insert(entries.end(), parts[i].entries.begin(), parts[i].entries.end());
+                parts[i] = SeekableFrames();
+            }
+            writeSeekTable(out.data() + written, layout, entries);
+            out.setSize(total);
+            out.shrinkToFit();
+        }
+
+        Napi::Value result(Napi::Env env) override {
+            return out.toBuffer(env);
+        }
+
+        Napi::ObjectReference inputRef;
+        const CompressOptions options;
+        const SeekableLayout layout;
+        const SizeLimits limits;
+        std::vector<SeekableFrames> parts;
+        OutputBuffer out;
+    };
+
+    Napi::Promise queueSeekableCompress(Napi::Env env, const InputBytes& input, CompressOptions options,
+                                        size_t frameSize, const SizeLimits& limits) {
+        validateSize(input.Length(), limits.maxInput, "Input");
+        auto job = std::make_shared<SeekableCompressJob>(env, input, std::move(options), frameSize, limits);
+        const SeekableLayout& layout = job->layout;
+        validateSize(layout.bound(0, layout.frames) + layout.tableSize(), limits.maxOutput, "Output");
+
+        // An empty input still gets its (empty) seek table, from one job
+        auto ranges = layout.frames == 0 ? std::vector<std::pair<size_t, size_t>>{ { 0, 0 } } :
+            splitRanges(layout.frames, [&](size_t i) { return layout.frameLength(i); });
+        job->parts.resize(ranges.size());
+        return queueRanges(env, "zstdCompressSeekable", job, ranges);
+    }
+
+    // Seekable inputs of at least this many frames and bytes of content are
+    // decoded by zstdDecompress in parallel
+    constexpr size_t PARALLEL_DECODE_MIN_FRAMES = 2;
+    constexpr size_t PARALLEL_DECODE_MIN_SIZE = 1ULL << 20;
+
+    // zstdDecompress of seekable input: ranges of frames are decoded on their
+    // threads' pooled contexts straight into their offsets of one output block.
+    struct ParallelDecodeJob : RangeJob {
+        ParallelDecodeJob(Napi::Env env, const InputBytes& input, DecompressOptions options,
+                          std::vector<SeekEntry> entries, size_t contentSize)
+            : RangeJob(env),
+              inputRef(Napi::Persistent(input.object)),
+              src(input.Data()),
+              options(std::move(options)),
+              entries(std::move(entries)),
+              out(contentSize) {
+            out.setSize(contentSize);
+        }
+
+        void run(size_t, size_t begin, size_t end) override {
+            ZSTD_DCtx* dctx = threadDCtx();
+            for (size_t i = begin; i < end && !failed; i++) {
+                const SeekEntry& entry = entries[i];
+                const size_t size = decompressTo(dctx, out.data() + entry.decompressedOffset, entry.decompressedSize,
+                                                 src + entry.compressedOffset, entry.compressedSize, options);
+                if (size != entry.decompressedSize) {
+                    throw std::runtime_error("Invalid seekable data: Frame " + std::to_string(i) +
+                                             " size does not match the seek table");
+                }
+            }
+        }
+
+        Napi::Value result(Napi::Env env) override {
+            return out.toBuffer(env);
+        }
+
+        Napi::ObjectReference inputRef;
+        const uint8_t* src;
+        const DecompressOptions options;
+        const std::vector<SeekEntry> entries;
+        OutputBuffer out;
+    };
+
+    // Queues a parallel decode if src is seekable data worth splitting whose
+    // seek table covers every byte before it; returns nothing otherwise, and
+    // the input goes down the regular path, which also reports any damage.
+    std::optional<Napi::Promise> queueParallelDecode(Napi::Env env, const InputBytes& input,
+                                                     const DecompressOptions& options, const SizeLimits& limits) {
+        const uint8_t* src = input.Data();
+        const size_t srcSize = input.Length();
+        if (srcSize < SKIPPABLE_HEADER_SIZE + SEEKABLE_FOOTER_SIZE ||
+            readLE32(src + srcSize - 4) != SEEKABLE_MAGIC || srcSize > limits.maxInput) {
+            return std::nullopt;
+        }
+        std::vector<SeekEntry> entries;
+        try {
+            entries = readSeekTable(src, srcSize, limits);
+        } catch (const std::exception&) {
+            return std::nullopt;
+        }
+        if (entries.size() < PARALLEL_DECODE_MIN_FRAMES) {
+            return std::nullopt;
+        }
+        const SeekEntry& last = entries.back();
+        const size_t tableSize = SKIPPABLE_HEADER_SIZE + SEEKABLE_FOOTER_SIZE +
+            entries.size() * ((src[srcSize - 5] & SEEKABLE_CHECKSUM_FLAG) ? 12 : 8);
+        const size_t contentSize = last.decompressedOffset + last.decompressedSize;
+        if (last.compressedOffset + last.compressedSize != srcSize - tableSize ||
+            contentSize < PARALLEL_DECODE_MIN_SIZE || contentSize > limits.maxOutput) {
+            return std::nullopt;
+        }
+
+        auto ranges = splitRanges(entries.size(), [&](size_t i) { return entries[i].decompressedSize + 1; });
+        auto job = std::make_shared<ParallelDecodeJob>(env, input, options, std::move(entries), contentSize);
+        return queueRanges(env, "zstdDecompress", job, ranges);
+    }
+
+    inline Napi::Array getBatchItems(const Napi::CallbackInfo& info) {
+        if (info.Length() < 1 || !info[0].IsArray()) {
+            throw std::runtime_error("First argument must be an array of Buffers");
+        }
+        return info[0].As<Napi::Array>();
+    }
+
+    // { contiguous: true } in the options object selects { buffer, offsets } output
+    inline bool getContiguousOption(const Napi::CallbackInfo& info, size_t index) {
+        if (info.Length() <= index || !info[index].IsObject()) {
+            return false;
+        }
+        const Napi::Value value = info[index].As<Napi::Object>().Get("contiguous");
+        if (!value.IsUndefined() && !value.IsBoolean()) {
+            throw std::runtime_error("Option contiguous must be a boolean");
+        }
+        return value.IsBoolean() && value.As<Napi::Boolean>().Value();
+    }
+}
+
+Napi::Value CompressSync(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    CancellationPtr cancel;
+
+    try {
+        auto input = getInputBuffer(info);
+        CompressOptions options = getCompressOptions(info, 1);
+        cancel = options.cancel = Cancellation::fromOptions(info[1]);
+
+        if (input.Length() <= SMALL_INPUT_SIZE) {
+            return compressSmall(env, threadCCtx(), input.Data(), input.Length(), options, currentLimits(env));
+        }
+        OutputBuffer out = compressData(threadCCtx(), input.Data(), input.Length(), options, currentLimits(env));
+        return out.toBuffer(env);
+    }
+    catch (const std::exception& e) {
+        callError(env, e.what(), cancel).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+Napi::Value DecompressSync(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    CancellationPtr cancel;
+
+    try {
+        auto input = getInputBuffer(info);
+        DecompressOptions options = getDecompressOptions(info, 1);
+        cancel = options.cancel = Cancellation::fromOptions(info[1]);
+        options.digest = getDigestOption(info[1]);
+        Digest digest(options.digest);
+        Digest* const digesting = digest ? &digest : nullptr;
+
+        const SizeLimits limits = currentLimits(env);
+        ZSTD_DCtx* const dctx = threadDCtx();
+        if (auto contentSize = smallContentSize(input.Data(), input.Length(), options)) {
+            return withDigest(env, decompressSmall(env, dctx, input.Data(), input.Length(), *contentSize,
+                                                   options, limits, digesting), digest);
+        }
+        OutputBuffer out = decompressData(dctx, input.Data(), input.Length(), options, limits, digesting);
+        return withDigest(env, out.toBuffer(env), digest);
+    }
+    catch (const std::exception& e) {
+        callError(env, e.what(), cancel).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// compressInto(src, dst, [offset], [levelOrOptions]): compresses into caller memory on
+// the calling thread and returns the number of bytes written. The output
+// size limit does not apply since nothing is allocated.
+Napi::Value CompressInto(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    try {
+        auto input = getInputBuffer(info);
+        const ByteSpan dst = getDestination(info, 1);
+        const CompressOptions options = getCompressOptions(info, 3);
+
+        const size_t srcSize = input.Length();
+        validateSize(srcSize, currentLimits(env).maxInput, "Input");
+
+        // Empty input produces empty output, matching zstdCompress
+        if (srcSize == 0) {
+            return Napi::Number::New(env, 0);
+        }
+
+        // With rawFallback the input is stored instead when its frame would
+        // be larger, or would not fit where the stored form does
+        const bool storable = options.rawFallback && dst.size > srcSize;
+        const size_t written = compressTo(threadCCtx(), dst.data, dst.size, input.Data(), srcSize, options,
+                                          storable);
+        if (storable && (written == 0 || written > srcSize + 1)) {
+            std::memmove(dst.data + 1, input.Data(), srcSize);
+            dst.data[0] = RAW_MARKER;
+            return Napi::Number::New(env, static_cast<double>(srcSize + 1));
+        }
+        return Napi::Number::New(env, static_cast<double>(written));
+    }
+    catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// decompressInto(src, dst, [offset], [options]): decompresses every frame of src into
+// caller memory on the calling thread and returns the number of bytes written.
+Napi::Value DecompressInto(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    try {
+        auto input = getInputBuffer(info);
+        const ByteSpan dst = getDestination(info, 1);
+        const DecompressOptions options = getDecompressOptions(info, 3);
+
+        const size_t srcSize = input.Length();
+        validateSize(srcSize, currentLimits(env).maxInput, "Input");
+
+        if (srcSize == 0) {
+            return Napi::Number::New(env, 0);
+        }
+
+        if (options.rawFallback && input.Data()[0] == RAW_MARKER) {
+            if (srcSize - 1 > dst.size) {
+                throw std::runtime_error("Decompression failed: Destination buffer is too small");
+            }
+            std::memmove(dst.data, input.Data() + 1, srcSize - 1);
+            return Napi::Number::New(env, static_cast<double>(srcSize - 1));
+        }
+
+        const size_t written = decompressTo(threadDCtx(), dst.data, dst.size, input.Data(), srcSize, options);
+        return Napi::Number::New(env, static_cast<double>(written));
+    }
+    catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+Napi::Value CompressBound(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        Napi::TypeError::New(env, "Expected a number argument").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    try {
+        const size_t size = safeConvertToSizeT(info[0].As<Napi::Number>().Int64Value(), "Size");
+        const size_t bound = ZSTD_compressBound(size);
+        if (ZSTD_isError(bound)) {
+            throw std::runtime_error("Size is too large");
+        }
+        return Napi::Number::New(env, static_cast<double>(bound));
+    } catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// trainDictionary(samples, capacity, [options]): trains a dictionary of at
+// most capacity bytes on the threadpool. Without fastCover options this is
+// ZDICT_trainFromBuffer; any of k, d, f, steps, accel, splitPoint, threads
+// switches to ZDICT_optimizeTrainFromBuffer_fastCover, which searches the
+// parameters left at 0.
+Napi::Value TrainDictionary(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    try {
+        if (info.Length() < 1 || !info[0].IsArray()) {
+            throw std::runtime_error("First argument must be an array of Buffers");
+        }
+        auto samples = info[0].As<Napi::Array>();
+        if (samples.Length() == 0) {
+            throw std::runtime_error("At least one sample is required");
+        }
+
+        if (info.Length() < 2 || !info[1].IsNumber()) {
+            throw std::runtime_error("Second argument must be the dictionary capacity");
+        }
+        const size_t capacity = safeConvertToSizeT(info[1].As<Napi::Number>().Int64Value(), "Dictionary capacity");
+        if (capacity < ZDICT_DICTSIZE_MIN) {
+            throw std::runtime_error("Dictionary capacity must be at least " + std::to_string(ZDICT_DICTSIZE_MIN) + " bytes");
+        }
+        validateSize(capacity, currentLimits(env).maxOutput, "Output");
+
+        ZDICT_fastCover_params_t params;
+        std::memset(&params, 0, sizeof(params));
+        bool optimize = false;
+        if (info.Length() > 2 && !info[2].IsUndefined() && !info[2].IsNull()) {
+            if (!info[2].IsObject()) {
+                throw std::runtime_error("Options must be an object");
+            }
+            auto options = info[2].As<Napi::Object>();
+            // ZDICT_trainFromBuffer takes no parameters, so level and dictID
+            // select fastCover as well
+            for (const char* name : { "k", "d", "f", "steps", "accel", "splitPoint", "threads", "level", "dictID" }) {
+                optimize = optimize || !options.Get(name).IsUndefined();
+            }
+            params.k = getUnsignedOption(options, "k", 0, 1U << 20);
+            params.d = getUnsignedOption(options, "d", 0, 16);
+            params.f = getUnsignedOption(options, "f", 0, 31);
+            params.steps = getUnsignedOption(options, "steps", 0, 1U << 16);
+            params.accel = getUnsignedOption(options, "accel", 0, 10);
+            params.nbThreads = getUnsignedOption(options, "threads", 1, 256);
+            const Napi::Value splitPoint = options.Get("splitPoint");
+            if (!splitPoint.IsUndefined()) {
+                params.splitPoint = splitPoint.IsNumber() ? splitPoint.As<Napi::Number>().DoubleValue() : -1;
+                if (!(params.splitPoint > 0 && params.splitPoint <= 1)) {
+                    throw std::runtime_error("Option splitPoint must be in (0, 1]");
+                }
+            }
+            const Napi::Value level = options.Get("level");
+            if (!level.IsUndefined()) {
+                if (!level.IsNumber()) {
+                    throw std::runtime_error("Option level must be a number");
+                }
+                params.zParams.compressionLevel = validateLevel(level.As<Napi::Number>().Int32Value());
+            }
+            params.zParams.dictID = getUnsignedOption(options, "dictID", 0, UINT32_MAX);
+        }
+
+        auto* worker = new TrainDictionaryWorker(env, samples, capacity, optimize, params);
+        auto promise = worker->Promise();
+        queueWork(worker, SIZE_MAX);
+        return promise;
+    }
+    catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+Napi::Value Compress(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    CancellationPtr cancel;
+
+    try {
+        auto input = getInputBuffer(info);
+        CompressOptions options = getCompressOptions(info, 1);
+        cancel = options.cancel = Cancellation::fromOptions(info[1]);
+
+        // Settled inline: the round trip would cost more than the work
+        if (input.Length() <= SMALL_INPUT_SIZE && compressesInline(options)) {
+            auto deferred = Napi::Promise::Deferred::New(env);
+            deferred.Resolve(compressSmall(env, threadCCtx(), input.Data(), input.Length(), options, currentLimits(env)));
+            return deferred.Promise();
+        }
+
+        auto* worker = new CompressWorker(env, input, std::move(options), currentLimits(env));
+        auto promise = worker->Promise();
+        queueWork(worker, input.Length());
+        return promise;
+    }
+    catch (const std::exception& e) {
+        callError(env, e.what(), cancel).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+Napi::Value Decompress(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    CancellationPtr cancel;
+
+    try {
+        auto input = getInputBuffer(info);
+        DecompressOptions options = getDecompressOptions(info, 1);
+        cancel = options.cancel = Cancellation::fromOptions(info[1]);
+        options.digest = getDigestOption(info[1]);
+
+        const SizeLimits limits = currentLimits(env);
+        Digest digest(options.digest);
+        if (auto contentSize = smallContentSize(input.Data(), input.Length(), options)) {
+            Napi::Buffer<uint8_t> small = decompressSmall(env, threadDCtx(), input.Data(), input.Length(),
+                                                          *contentSize, options, limits, digest ? &digest : nullptr);
+            auto deferred = Napi::Promise::Deferred::New(env);
+            deferred.Resolve(withDigest(env, small, digest));
+            return deferred.Promise();
+        }
+        // Cancellable and digested calls decode on one thread, in steps
+        const bool stored = options.rawFallback && input.Length() > 0 && input.Data()[0] == RAW_MARKER;
+        const bool stepped = options.cancel || options.digest;
+        if (auto parallel = stored || stepped ? std::nullopt : queueParallelDecode(env, input, options, limits)) {
+            return *parallel;
+        }
+
+        auto* worker = new DecompressWorker(env, input, std::move(options), limits);
+        auto promise = worker->Promise();
+        queueWork(worker, input.Length());
+        return promise;
+    }
+    catch (const std::exception& e) {
+        callError(env, e.what(), cancel).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// compressDelta(src, base, [levelOrOptions]): compresses src against base,
+// which is referenced in place as a prefix. Frames need the same base to decode.
+Napi::Value CompressDelta(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    try {
+        auto input = getInputBuffer(info);
+        auto base = getInputBytes(info.Length() > 1 ? info[1] : env.Undefined(), "Base");
+        CompressOptions options = getCompressOptions(info, 2);
+        if (options.dictionary) {
+            throw std::runtime_error("compressDelta does not take a dictionary; the base is its dictionary");
+        }
+        if (options.rawFallback) {
+            throw std::runtime_error("compressDelta does not take rawFallback");
+        }
+
+        const SizeLimits limits = currentLimits(env);
+        validateSize(base.Length(), limits.maxInput, "Base");
+        options.prefix = base.Data();
+        options.prefixSize = base.Length();
+        applyDeltaParameters(options, base.Length(), input.Length());
+
+        auto* worker = new CompressWorker(env, input, std::move(options), limits);
+        worker->Retain(base);
+        auto promise = worker->Promise();
+        queueWork(worker, input.Length());
+        return promise;
+    }
+    catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// decompressDelta(patch, base): decodes output of compressDelta with the same base
+Napi::Value DecompressDelta(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    try {
+        auto input = getInputBuffer(info);
+        auto base = getInputBytes(info.Length() > 1 ? info[1] : env.Undefined(), "Base");
+
+        const SizeLimits limits = currentLimits(env);
+        validateSize(base.Length(), limits.maxInput, "Base");
+        DecompressOptions options;
+        options.prefix = base.Data();
+        options.prefixSize = base.Length();
+        options.windowLogMax = deltaWindowLogMax(base.Length(), limits);
+
+        auto* worker = new DecompressWorker(env, input, std::move(options), limits);
+        worker->Retain(base);
+        auto promise = worker->Promise();
+        queueWork(worker, input.Length());
+        return promise;
+    }
+    catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// compressFile(src, dst, [levelOrOptions]): compresses the file at src into
+// dst on the threadpool, reading through mmap where possible. The size
+// limits do not apply; memory is bounded by the output window.
+Napi::Value CompressFile(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    try {
+        std::string src = getPath(info, 0, "Source");
+        std::string dst = getPath(info, 1, "Destination");
+        CompressOptions options = getCompressOptions(info, 2);
+        options.cancel = Cancellation::fromOptions(info[2]);
+        options.digest = getDigestOption(info[2]);
+        const size_t windowSize = getFileWindowSize(info, 2);
+
+        auto* worker = new FileWorker<CompressOptions>(env, "zstdCompressFile", std::move(src), std::move(dst),
+                                                       std::move(options), windowSize);
+        auto promise = worker->Promise();
+        queueWork(worker, SIZE_MAX);
+        return promise;
+    }
+    catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// decompressFile(src, dst, [options]): the decompressing counterpart of
+// compressFile; accepts any number of frames, with or without content size
+Napi::Value DecompressFile(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    try {
+        std::string src = getPath(info, 0, "Source");
+        std::string dst = getPath(info, 1, "Destination");
+        DecompressOptions options = getDecompressOptions(info, 2);
+        options.cancel = Cancellation::fromOptions(info[2]);
+        options.digest = getDigestOption(info[2]);
+        const size_t windowSize = getFileWindowSize(info, 2);
+
+        auto* worker = new FileWorker<DecompressOptions>(env, "zstdDecompressFile", std::move(src), std::move(dst),
+                                                         std::move(options), windowSize);
+        auto promise = worker->Promise();
+        queueWork(worker, SIZE_MAX);
+        return promise;
+    }
+    catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// compressSeekable(buffer, [levelOrOptions]): compresses into the seekable
+// format on the threadpool, one independent frame per options.frameSize bytes
+Napi::Value CompressSeekable(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    try {
+        auto input = getInputBuffer(info);
+        CompressOptions options = getCompressOptions(info, 1);
+        const size_t frameSize = getFrameSize(info, 1);
+
+        return queueSeekableCompress(env, input, std::move(options), frameSize, currentLimits(env));
+    }
+    catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// readRange(buffer, offset, [length], [options]): decompresses length bytes of
+// seekable data starting at content offset, touching only the frames needed.
+// The input limit does not apply, since the blob is not decoded as a whole.
+Napi::Value ReadRange(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    try {
+        auto input = getInputBuffer(info);
+        const ByteRange range = getRange(info, 1);
+        DecompressOptions options = getDecompressOptions(info, 3);
+
+        auto* worker = new ReadRangeWorker(env, input, range.offset, range.length,
+                                           std::move(options), currentLimits(env));
+        auto promise = worker->Promise();
+        queueWork(worker, range.length);
+        return promise;
+    }
+    catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+Napi::Value ReadRangeSync(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    try {
+        auto input = getInputBuffer(info);
+        const ByteRange range = getRange(info, 1);
+        const DecompressOptions options = getDecompressOptions(info, 3);
+
+        OutputBuffer out = readSeekableRange(threadDCtx(), input.Data(), input.Length(),
+                                             range.offset, range.length, options, currentLimits(env));
+        return out.toBuffer(env);
+    }
+    catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
     }
+}
 
-    inline size_t safeConvertToSizeT(int64_t value, const std::string& context) {
-        if (value < 0) {
-            throw std::runtime_error(context + " cannot be negative");
-        }
-        if (static_cast<uint64_t>(value) > SIZE_MAX) {
-            throw std::runtime_error(context + " is too large");
-        }
-        return static_cast<size_t>(value);
+// compressBatch(buffers, [levelOrOptions]): compresses every Buffer of the
+// array in one call, spread over the threadpool. Resolves to an array of
+// Buffers, or { buffer, offsets } with { contiguous: true }.
+Napi::Value CompressBatch(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    try {
+        auto items = getBatchItems(info);
+        CompressOptions options = getCompressOptions(info, 1);
+        options.cancel = Cancellation::fromOptions(info[1]);
+        const bool contiguous = getContiguousOption(info, 1);
+
+        return queueBatch(env, "zstdCompressBatch", items, std::move(options), contiguous);
+    }
+    catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
     }
 }
 
-// Config setter functions
-Napi::Value SetMaxInputSize(const Napi::CallbackInfo& info) {
+// decompressBatch(buffers, [options]): the decompressing counterpart of compressBatch
+Napi::Value DecompressBatch(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    
-    if (info.Length() < 1 || !info[0].IsNumber()) {
-        Napi::TypeError::New(env, "Expected a number argument").ThrowAsJavaScriptException();
+
+    try {
+        auto items = getBatchItems(info);
+        DecompressOptions options = getDecompressOptions(info, 1);
+        options.cancel = Cancellation::fromOptions(info[1]);
+        const bool contiguous = getContiguousOption(info, 1);
+
+        return queueBatch(env, "zstdDecompressBatch", items, std::move(options), contiguous);
+    }
+    catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
         return env.Null();
     }
+}
+
+// getFrameInfo(buffer): header metadata of every frame, from the frame
+// headers and ZSTD_findFrameCompressedSize alone; nothing is decoded or
+// allocated natively, and the size limits do not apply.
+Napi::Value GetFrameInfo(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
 
     try {
-        const int64_t value = info[0].As<Napi::Number>().Int64Value();
-        const size_t new_size = safeConvertToSizeT(value, "Input size limit");
-        
-        std::lock_guard<std::mutex> lock(g_size_mutex);
-        g_max_input_size = new_size;
-        return env.Undefined();
-    } catch (const std::exception& e) {
+        auto input = getInputBuffer(info);
+        const uint8_t* src = input.Data();
+        const size_t srcSize = input.Length();
+        const auto number = [&](unsigned long long value) {
+            return Napi::Number::New(env, static_cast<double>(value));
+        };
+
+        auto frames = Napi::Array::New(env);
+        unsigned long long contentSize = 0;
+        bool unknownSize = false;
+        size_t pos = 0;
+        while (pos < srcSize) {
+            const size_t frameSize = ZSTD_findFrameCompressedSize(src + pos, srcSize - pos);
+            if (ZSTD_isError(frameSize)) {
+                throw std::runtime_error("Invalid compressed data at offset " + std::to_string(pos) + ": " +
+                                         ZSTD_getErrorName(frameSize));
+            }
+            ZSTD_frameHeader header;
+            const size_t result = ZSTD_getFrameHeader(&header, src + pos, frameSize);
+            if (result != 0) {
+                throw std::runtime_error("Invalid compressed data at offset " + std::to_string(pos) + ": " +
+                                         (ZSTD_isError(result) ? ZSTD_getErrorName(result) : "Truncated frame header"));
+            }
+
+            auto frame = Napi::Object::New(env);
+            frame.Set("offset", number(pos));
+            frame.Set("compressedSize", number(frameSize));
+            frame.Set("headerSize", number(header.headerSize));
+            if (header.frameType == ZSTD_skippableFrame) {
+                // For skippable frames the header carries the payload size and
+                // the low 4 bits of the magic number
+                frame.Set("type", Napi::String::New(env, "skippable"));
+                frame.Set("contentSize", number(header.frameContentSize));
+                frame.Set("magicVariant", number(header.dictID));
+                frame.Set("seekTable", Napi::Boolean::New(env,
+                    ZSTD_MAGIC_SKIPPABLE_START + header.dictID == SEEK_TABLE_MAGIC &&
+                    frameSize >= SKIPPABLE_HEADER_SIZE + SEEKABLE_FOOTER_SIZE &&
+                    readLE32(src + pos + frameSize - 4) == SEEKABLE_MAGIC));
+            } else {
+                const bool known = header.frameContentSize != ZSTD_CONTENTSIZE_UNKNOWN;
+                frame.Set("type", Napi::String::New(env, "zstd"));
+                frame.Set("contentSize", known ? number(header.frameContentSize) : env.Null());
+                frame.Set("windowSize", number(header.windowSize));
+                frame.Set("blockSizeMax", number(header.blockSizeMax));
+                frame.Set("dictionaryId", number(ZSTD_getDictID_fromFrame(src + pos, frameSize)));
+                frame.Set("checksum", Napi::Boolean::New(env, header.checksumFlag != 0));
+                if (!known) {
+                    unknownSize = true;
+                } else {
+                    contentSize += header.frameContentSize;
+                }
+            }
+            frames.Set(frames.Length(), frame);
+            pos += frameSize;
+        }
+
+        auto result = Napi::Object::New(env);
+        result.Set("frames", frames);
+        result.Set("compressedSize", number(srcSize));
+        result.Set("contentSize", unknownSize ? env.Null() : number(contentSize));
+        return result;
+    }
+    catch (const std::exception& e) {
         Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
         return env.Null();
     }
 }
 
-Napi::Value SetMaxOutputSize(const Napi::CallbackInfo& info) {
+// getStats(): process-wide totals of the native counters. Values are plain
+// Numbers, exact up to 2^53.
+Napi::Value GetStats(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    
+    StatRegistry& registry = stats();
+    uint64_t totals[STAT_COUNTERS];
+    registry.sum(totals);
+
+    const auto number = [&](uint64_t value) { return Napi::Number::New(env, static_cast<double>(value)); };
+    const auto codec = [&](StatCounter base) {
+        auto result = Napi::Object::New(env);
+        result.Set("calls", number(totals[base]));
+        result.Set("bytesIn", number(totals[base + 1]));
+        result.Set("bytesOut", number(totals[base + 2]));
+        result.Set("nanoseconds", number(totals[base + 3]));
+        return result;
+    };
+
+    auto contextPool = Napi::Object::New(env);
+    contextPool.Set("compressHits", number(totals[STAT_CCTX_HITS]));
+    contextPool.Set("compressMisses", number(totals[STAT_CCTX_MISSES]));
+    contextPool.Set("decompressHits", number(totals[STAT_DCTX_HITS]));
+    contextPool.Set("decompressMisses", number(totals[STAT_DCTX_MISSES]));
+
+    auto result = Napi::Object::New(env);
+    result.Set("compress", codec(STAT_COMPRESS_CALLS));
+    result.Set("decompress", codec(STAT_DECOMPRESS_CALLS));
+    result.Set("contextPool", contextPool);
+    result.Set("queueDepth", number(registry.queueDepth.load(std::memory_order_relaxed)));
+    result.Set("peakQueueDepth", number(registry.peakQueueDepth.load(std::memory_order_relaxed)));
+    result.Set("peakOutputAllocation", number(registry.peakOutputAllocation.load(std::memory_order_relaxed)));
+
+    BlockPool& pool = blockPool();
+    auto bufferPool = Napi::Object::New(env);
+    bufferPool.Set("hits", number(pool.hits.load(std::memory_order_relaxed)));
+    bufferPool.Set("misses", number(pool.misses.load(std::memory_order_relaxed)));
+    bufferPool.Set("idleBytes", number(pool.idleBytes()));
+    result.Set("bufferPool", bufferPool);
+    result.Set("threadPool", threadPool().stats(env));
+    return result;
+}
+
+// setMemoryBudget(bytes): caps native memory across the process; 0 removes the cap.
+// Memory already in use is kept even if it exceeds a new, lower budget.
+Napi::Value SetMemoryBudget(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
     if (info.Length() < 1 || !info[0].IsNumber()) {
         Napi::TypeError::New(env, "Expected a number argument").ThrowAsJavaScriptException();
         return env.Null();
@@ -87,82 +4857,168 @@ Napi::Value SetMaxOutputSize(const Napi::CallbackInfo& info) {
 
     try {
         const int64_t value = info[0].As<Napi::Number>().Int64Value();
-        const size_t new_size = safeConvertToSizeT(value, "Output size limit");
-        
-        std::lock_guard<std::mutex> lock(g_size_mutex);
-        g_max_output_size = new_size;
+        memoryBudget().limit.store(safeConvertToSizeT(value, "Memory budget"), std::memory_order_relaxed);
         return env.Undefined();
-    } catch (const std::exception& e) {
+    }
+    catch (const std::exception& e) {
         Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
         return env.Null();
     }
 }
 
-Napi::Value GetLimits(const Napi::CallbackInfo& info) {
+Napi::Value GetMemoryUsage(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    
-    std::lock_guard<std::mutex> lock(g_size_mutex);
-    
+    MemoryBudget& budget = memoryBudget();
+
+    const auto number = [&](const std::atomic<uint64_t>& value) {
+        return Napi::Number::New(env, static_cast<double>(value.load(std::memory_order_relaxed)));
+    };
     auto result = Napi::Object::New(env);
-    result.Set("maxInputSize", Napi::Number::New(env, static_cast<double>(g_max_input_size)));
-    result.Set("maxOutputSize", Napi::Number::New(env, static_cast<double>(g_max_output_size)));
+    result.Set("budget", number(budget.limit));
+    result.Set("total", number(budget.total));
+    for (int kind = 0; kind < MEMORY_KINDS; kind++) {
+        result.Set(MEMORY_KIND_NAMES[kind], number(budget.used[kind]));
+    }
+    result.Set("peak", number(budget.peak));
+    result.Set("rejected", number(budget.rejected));
     return result;
 }
 
-Napi::Value Compress(const Napi::CallbackInfo& info) {
+// configureContextArena([levelOrOptions]): places every thread's pooled
+// contexts in one arena sized for the options, { slots, maxInputSize } included.
+Napi::Value ConfigureContextArena(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
     try {
-        // Validate input
-        if (info.Length() < 1 || !info[0].IsBuffer()) {
-            throw std::runtime_error("First argument must be a Buffer");
+        if (contextArena()) {
+            throw std::runtime_error("Context arena is already configured");
         }
-
-        // Get compression level
-        const int level = info.Length() > 1 && info[1].IsNumber() ?
-            validateLevel(info[1].As<Napi::Number>().Int32Value()) :
-            DEFAULT_LEVEL;
-            
-        // Get input buffer
-        auto input = info[0].As<Napi::Buffer<uint8_t>>();
-        const size_t srcSize = input.Length();
-        
-        // Check input size
-        {
-            std::lock_guard<std::mutex> lock(g_size_mutex);
-            validateSize(srcSize, g_max_input_size, "Input");
+        const CompressOptions options = getCompressOptions(info, 0);
+        if (options.workers != 0) {
+            throw std::runtime_error("Arena contexts are single-threaded; workers are not available");
+        }
+        unsigned long long size = ZSTD_CONTENTSIZE_UNKNOWN;
+        size_t slots = defaultArenaSlots();
+        if (info.Length() > 0 && info[0].IsObject()) {
+            auto object = info[0].As<Napi::Object>();
+            if (auto maxInputSize = getSizeOption(object, "maxInputSize")) {
+                size = *maxInputSize;
+            }
+            slots = getUnsignedOption(object, "slots", static_cast<unsigned>(slots), 1024);
+            if (slots == 0) {
+                throw std::runtime_error("Option slots must be an integer between 1 and 1024");
+            }
         }
 
-        // Fast path for empty input
-        if (srcSize == 0) {
-            return Napi::Buffer<uint8_t>::Copy(env, nullptr, 0);
+        const int level = options.currentLevel();
+        // Slots hold the stream buffers too, which large inputs use
+        auto arena = std::make_unique<ContextArena>(
+            estimateCompressMemory(options, size, level, true),
+            ZSTD_estimateDStreamSize(size_t{1} << windowLogOf(options, size, level)),
+            slots);
+        ContextArena* expected = nullptr;
+        if (!g_contextArena.compare_exchange_strong(expected, arena.get(), std::memory_order_acq_rel)) {
+            throw std::runtime_error("Context arena is already configured");
         }
+        ContextArena* configured = arena.release();
 
-        const size_t bound = ZSTD_compressBound(srcSize);
-        
-        // Check output size
-        {
-            std::lock_guard<std::mutex> lock(g_size_mutex);
-            validateSize(bound, g_max_output_size, "Output");
+        const auto number = [&](size_t value) { return Napi::Number::New(env, static_cast<double>(value)); };
+        auto result = Napi::Object::New(env);
+        result.Set("slots", number(configured->slots()));
+        result.Set("compressSlotSize", number(configured->compressSlotSize()));
+        result.Set("decompressSlotSize", number(configured->decompressSlotSize()));
+        result.Set("bytes", number(configured->bytes()));
+        return result;
+    }
+    catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// configureBufferPool({ maxIdleBytes, maxBlockSize }): recycles output blocks
+// up to maxBlockSize; maxIdleBytes 0 (the default) turns the pool off.
+Napi::Value ConfigureBufferPool(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    try {
+        size_t maxIdle = 0;
+        size_t maxBlock = DEFAULT_POOL_BLOCK_SIZE;
+        if (info.Length() > 0 && !info[0].IsUndefined() && !info[0].IsNull()) {
+            if (!info[0].IsObject()) {
+                throw std::runtime_error("Options must be an object");
+            }
+            auto object = info[0].As<Napi::Object>();
+            maxIdle = getSizeOption(object, "maxIdleBytes").value_or(0);
+            maxBlock = getSizeOption(object, "maxBlockSize").value_or(maxBlock);
         }
+        blockPool().configure(maxIdle, maxBlock);
+        return env.Undefined();
+    }
+    catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
 
-        std::vector<uint8_t> out(bound);
+// configureThreadPool({ threads, latencyThreads, latencyJobSize, affinity }):
+// runs the asynchronous calls on threads of the addon's own; threads 0 (the
+// default) goes back to the libuv threadpool. Returns the configuration.
+Napi::Value ConfigureThreadPool(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
 
-        const size_t compSize = ZSTD_compress(
-            out.data(),
-            bound,
-            input.Data(),
-            srcSize,
-            level
-        );
+    try {
+        ThreadPool::Config config;
+        config.threads = std::max(1u, std::thread::hardware_concurrency());
+        std::optional<size_t> latencyThreads;
+        if (info.Length() > 0 && !info[0].IsUndefined() && !info[0].IsNull()) {
+            if (!info[0].IsObject()) {
+                throw std::runtime_error("Options must be an object");
+            }
+            auto object = info[0].As<Napi::Object>();
+            config.threads = getSizeOption(object, "threads").value_or(config.threads);
+            latencyThreads = getSizeOption(object, "latencyThreads");
+            config.latencyJobSize = getSizeOption(object, "latencyJobSize").value_or(config.latencyJobSize);
 
-        // Check for compression errors
-        if (ZSTD_isError(compSize)) {
-            throw std::runtime_error(std::string("Compression failed: ") + ZSTD_getErrorName(compSize));
+            const Napi::Value affinity = object.Get("affinity");
+            if (!affinity.IsUndefined()) {
+                if (!affinity.IsArray()) {
+                    throw std::runtime_error("Option affinity must be an array of CPU numbers");
+                }
+#ifndef __linux__
+                throw std::runtime_error("Option affinity is only supported on Linux");
+#else
+                auto cpus = affinity.As<Napi::Array>();
+                for (uint32_t i = 0; i < cpus.Length(); i++) {
+                    const Napi::Value cpu = cpus.Get(i);
+                    if (!cpu.IsNumber() || cpu.As<Napi::Number>().Int64Value() < 0 ||
+                        cpu.As<Napi::Number>().Int64Value() >= CPU_SETSIZE) {
+                        throw std::runtime_error("Option affinity must be an array of CPU numbers");
+                    }
+                    config.affinity.push_back(static_cast<unsigned>(cpu.As<Napi::Number>().Int64Value()));
+                }
+#endif
+            }
         }
+        if (config.threads > MAX_POOL_THREADS) {
+            throw std::runtime_error("Option threads must be at most " + std::to_string(MAX_POOL_THREADS));
+        }
+        // One thread kept for small jobs once there are two to share
+        config.latencyThreads = latencyThreads.value_or(config.threads > 1 ? 1 : 0);
+        if (config.threads > 0 && config.latencyThreads >= config.threads) {
+            throw std::runtime_error("Option latencyThreads must be less than threads");
+        }
+        if (config.threads == 0) {
+            config.latencyThreads = 0;
+        }
+
+        threadPool().configure(config);
 
-        // Return compressed buffer
-        return Napi::Buffer<uint8_t>::Copy(env, out.data(), compSize);
+        auto result = Napi::Object::New(env);
+        result.Set("threads", Napi::Number::New(env, static_cast<double>(config.threads)));
+        result.Set("latencyThreads", Napi::Number::New(env, static_cast<double>(config.latencyThreads)));
+        result.Set("latencyJobSize", Napi::Number::New(env, static_cast<double>(config.latencyJobSize)));
+        return result;
     }
     catch (const std::exception& e) {
         Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
@@ -170,81 +5026,539 @@ Napi::Value Compress(const Napi::CallbackInfo& info) {
     }
 }
 
-Napi::Value Decompress(const Napi::CallbackInfo& info) {
+// estimateMemory([levelOrOptions], [size]): context sizes for the options,
+// for inputs of size bytes (default: unknown, the worst case)
+Napi::Value EstimateMemory(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
     try {
-        // Validate input
-        if (info.Length() < 1 || !info[0].IsBuffer()) {
-            throw std::runtime_error("First argument must be a Buffer");
+        const CompressOptions options = getCompressOptions(info, 0);
+        unsigned long long size = ZSTD_CONTENTSIZE_UNKNOWN;
+        if (info.Length() > 1 && !info[1].IsUndefined()) {
+            if (!info[1].IsNumber()) {
+                throw std::runtime_error("Size must be a number");
+            }
+            size = safeConvertToSizeT(info[1].As<Napi::Number>().Int64Value(), "Size");
         }
 
-        // Get input buffer
-        auto input = info[0].As<Napi::Buffer<uint8_t>>();
-        const size_t srcSize = input.Length();
+        const int level = options.currentLevel();
+        const int windowLog = windowLogOf(options, size, level);
 
-        // Check input size
-        {
-            std::lock_guard<std::mutex> lock(g_size_mutex);
-            validateSize(srcSize, g_max_input_size, "Input");
+        const auto number = [&](size_t value) { return Napi::Number::New(env, static_cast<double>(value)); };
+        auto result = Napi::Object::New(env);
+        result.Set("compress", number(estimateCompressMemory(options, size, level, false)));
+        result.Set("compressStream", number(estimateCompressMemory(options, size, level, true)));
+        result.Set("decompress", number(ZSTD_estimateDCtxSize()));
+        result.Set("decompressStream", number(ZSTD_estimateDStreamSize(size_t{1} << windowLog)));
+        return result;
+    }
+    catch (const std::exception& e) {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// Dictionary: a dictionary digested once and shared by every call it is
+// passed to, e.g. zstdCompress(buf, { dictionary }).
+class Dictionary : public Napi::ObjectWrap<Dictionary> {
+public:
+    static Napi::Function Define(Napi::Env env) {
+        return DefineClass(env, "Dictionary", {
+            InstanceAccessor("id", &Dictionary::GetId, nullptr),
+            InstanceAccessor("size", &Dictionary::GetSize, nullptr),
+            InstanceAccessor("level", &Dictionary::GetLevel, nullptr)
+        });
+    }
+
+    // new Dictionary(buffer, [level])
+    Dictionary(const Napi::CallbackInfo& info)
+        : Napi::ObjectWrap<Dictionary>(info) {
+        Napi::Env env = info.Env();
+
+        try {
+            auto content = getInputBuffer(info);
+            if (content.Length() == 0) {
+                throw std::runtime_error("Dictionary must not be empty");
+            }
+            data_ = loadDictionary(content.Data(), content.Length(), getLevel(info, 1));
+            Value().TypeTag(&DICTIONARY_TYPE_TAG);
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
         }
+    }
 
-        if (srcSize == 0) {
-            return Napi::Buffer<uint8_t>::Copy(env, nullptr, 0);
+    const DictionaryPtr& data() const { return data_; }
+
+private:
+    Napi::Value GetId(const Napi::CallbackInfo& info) {
+        return Napi::Number::New(info.Env(), data_ ? data_->id() : 0);
+    }
+
+    Napi::Value GetSize(const Napi::CallbackInfo& info) {
+        return Napi::Number::New(info.Env(), data_ ? static_cast<double>(data_->size()) : 0);
+    }
+
+    Napi::Value GetLevel(const Napi::CallbackInfo& info) {
+        return Napi::Number::New(info.Env(), data_ ? data_->level() : DEFAULT_LEVEL);
+    }
+
+    DictionaryPtr data_;
+};
+
+namespace {
+    DictionaryPtr getDictionary(const Napi::Value& value) {
+        if (value.IsUndefined() || value.IsNull()) {
+            return nullptr;
+        }
+        if (!value.IsObject() || !value.As<Napi::Object>().CheckTypeTag(&DICTIONARY_TYPE_TAG)) {
+            throw std::runtime_error("Option dictionary must be a Dictionary");
+        }
+        return Dictionary::Unwrap(value.As<Napi::Object>())->data();
+    }
+}
+
+// Compressor: JS-visible object that owns a dedicated compression context.
+// One operation may be in flight at a time; overlapping calls are rejected.
+class Compressor : public Napi::ObjectWrap<Compressor> {
+public:
+    static Napi::Function Define(Napi::Env env) {
+        return DefineClass(env, "Compressor", {
+            InstanceMethod("compress", &Compressor::Compress),
+            InstanceMethod("compressSync", &Compressor::CompressSync),
+            InstanceAccessor("level", &Compressor::GetLevel, nullptr)
+        });
+    }
+
+    Compressor(const Napi::CallbackInfo& info)
+        : Napi::ObjectWrap<Compressor>(info) {
+        Napi::Env env = info.Env();
+
+        try {
+            options_ = getCompressOptions(info, 0);
+            limits_ = getLimitOverrides(info, 0);
+            context_ = std::make_unique<CompressionContext>();
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
         }
+    }
+
+private:
+    Napi::Value Compress(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        try {
+            checkIdle();
+            auto input = getInputBuffer(info);
 
-        const unsigned long long decompressedSize = ZSTD_getFrameContentSize(input.Data(), srcSize);
-        
-        // Check for decompression size errors
-        if (ZSTD_isError(decompressedSize)) {
-            throw std::runtime_error(std::string("Invalid compressed data: ") + 
-                                   ZSTD_getErrorName(decompressedSize));
+            auto* worker = new CompressWorker(env, input, options_, limits_.resolve(env), context_.get());
+            worker->Lease(Value(), busy_);
+            auto promise = worker->Promise();
+            queueWork(worker, input.Length());
+            return promise;
         }
-        
-        if (decompressedSize == ZSTD_CONTENTSIZE_UNKNOWN) {
-            throw std::runtime_error("Cannot decompress: Size unknown (streaming not supported)");
+        catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
         }
+    }
 
-        // Check decompressed size
-        {
-            std::lock_guard<std::mutex> lock(g_size_mutex);
-            validateSize(decompressedSize, g_max_output_size, "Output");
+    Napi::Value CompressSync(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        try {
+            checkIdle();
+            auto input = getInputBuffer(info);
+
+            OutputBuffer out = compressData(*context_, input.Data(), input.Length(), options_, limits_.resolve(env));
+            return out.toBuffer(env);
+        }
+        catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
         }
+    }
 
-        std::vector<uint8_t> out(decompressedSize);
-        const size_t result = ZSTD_decompress(
-            out.data(),
-            decompressedSize,
-            input.Data(),
-            srcSize
-        );
+    Napi::Value GetLevel(const Napi::CallbackInfo& info) {
+        return Napi::Number::New(info.Env(), options_.currentLevel());
+    }
 
-        // Check for decompression errors
-        if (ZSTD_isError(result)) {
-            throw std::runtime_error(std::string("Decompression failed: ") + ZSTD_getErrorName(result));
+    void checkIdle() const {
+        if (!context_) {
+            throw std::runtime_error("Compressor is not initialized");
+        }
+        if (busy_) {
+            throw std::runtime_error("Compressor is busy with another operation");
+        }
+    }
+
+    std::unique_ptr<CompressionContext> context_;
+    CompressOptions options_;
+    LimitOverrides limits_;
+    bool busy_ = false;
+};
+
+// Decompressor: JS-visible object that owns a dedicated decompression context.
+// One operation may be in flight at a time; overlapping calls are rejected.
+class Decompressor : public Napi::ObjectWrap<Decompressor> {
+public:
+    static Napi::Function Define(Napi::Env env) {
+        return DefineClass(env, "Decompressor", {
+            InstanceMethod("decompress", &Decompressor::Decompress),
+            InstanceMethod("decompressSync", &Decompressor::DecompressSync)
+        });
+    }
+
+    Decompressor(const Napi::CallbackInfo& info)
+        : Napi::ObjectWrap<Decompressor>(info) {
+        Napi::Env env = info.Env();
+
+        try {
+            options_ = getDecompressOptions(info, 0);
+            limits_ = getLimitOverrides(info, 0);
+            dctx_ = createDCtx();
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
         }
+    }
+
+private:
+    Napi::Value Decompress(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        try {
+            checkIdle();
+            auto input = getInputBuffer(info);
 
-        return Napi::Buffer<uint8_t>::Copy(env, out.data(), result);
+            auto* worker = new DecompressWorker(env, input, options_, limits_.resolve(env), dctx_.get());
+            worker->Lease(Value(), busy_);
+            auto promise = worker->Promise();
+            queueWork(worker, input.Length());
+            return promise;
+        }
+        catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
     }
-    catch (const std::exception& e) {
-        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
-        return env.Null();
+
+    Napi::Value DecompressSync(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        try {
+            checkIdle();
+            auto input = getInputBuffer(info);
+
+            OutputBuffer out = decompressData(dctx_.get(), input.Data(), input.Length(), options_, limits_.resolve(env));
+            return out.toBuffer(env);
+        }
+        catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
     }
-}
 
-Napi::Object Init(Napi::Env env, Napi::Object exports) {
-    exports.Set("zstdCompress", Napi::Function::New(env, Compress));
-    exports.Set("zstdDecompress", Napi::Function::New(env, Decompress));
-    exports.Set("setMaxInputSize", Napi::Function::New(env, SetMaxInputSize));
-    exports.Set("setMaxOutputSize", Napi::Function::New(env, SetMaxOutputSize));
-    exports.Set("getLimits", Napi::Function::New(env, GetLimits));
-    
-    // Export constants
-    exports.Set("DEFAULT_LEVEL", Napi::Number::New(env, DEFAULT_LEVEL));
-    exports.Set("MIN_LEVEL", Napi::Number::New(env, MIN_LEVEL));
-    exports.Set("MAX_LEVEL", Napi::Number::New(env, MAX_LEVEL));
-    
-    return exports;
+    void checkIdle() const {
+        if (!dctx_) {
+            throw std::runtime_error("Decompressor is not initialized");
+        }
+        if (busy_) {
+            throw std::runtime_error("Decompressor is busy with another operation");
+        }
+    }
+
+    DCtxPtr dctx_;
+    DecompressOptions options_;
+    LimitOverrides limits_;
+    bool busy_ = false;
+};
+
+// Native half of the Transform streams in index.js. transform(chunk, offset,
+// mode, callback) runs one step on the threadpool; the JS side loops until the
+// step reports done. One step may be in flight at a time.
+template <typename Derived, typename Stream>
+class StreamHandle : public Napi::ObjectWrap<Derived> {
+public:
+    StreamHandle(const Napi::CallbackInfo& info)
+        : Napi::ObjectWrap<Derived>(info) {}
+
+protected:
+    static std::vector<typename Napi::ObjectWrap<Derived>::PropertyDescriptor> Methods() {
+        return {
+            Napi::ObjectWrap<Derived>::InstanceMethod("transform", &StreamHandle::Transform),
+            Napi::ObjectWrap<Derived>::InstanceMethod("transformSync", &StreamHandle::TransformSync),
+            Napi::ObjectWrap<Derived>::InstanceMethod("close", &StreamHandle::Close)
+        };
+    }
+
+    static size_t getWindowSize(const Napi::CallbackInfo& info, size_t index) {
+        if (info.Length() <= index || info[index].IsUndefined()) {
+            return 0;
+        }
+        if (!info[index].IsNumber()) {
+            throw std::runtime_error("Chunk size must be a number");
+        }
+        return safeConvertToSizeT(info[index].As<Napi::Number>().Int64Value(), "Chunk size");
+    }
+
+    std::unique_ptr<Stream> stream_;
+
+private:
+    struct StepArgs {
+        InputBytes chunk;
+        size_t offset;
+        ZSTD_EndDirective mode;
+    };
+
+    StepArgs getStepArgs(const Napi::CallbackInfo& info) {
+        if (!stream_) {
+            throw std::runtime_error("Stream is closed");
+        }
+        if (busy_) {
+            throw std::runtime_error("Stream is busy with another operation");
+        }
+        auto chunk = getInputBuffer(info);
+        const size_t offset = info.Length() > 1 && info[1].IsNumber() ?
+            safeConvertToSizeT(info[1].As<Napi::Number>().Int64Value(), "Offset") : 0;
+        if (offset > chunk.Length()) {
+            throw std::runtime_error("Offset is outside the chunk");
+        }
+        return { chunk, offset, getEndDirective(info.Length() > 2 ? info[2] : info.Env().Undefined()) };
+    }
+
+    Napi::Value Transform(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        try {
+            StepArgs args = getStepArgs(info);
+            if (info.Length() < 4 || !info[3].IsFunction()) {
+                throw std::runtime_error("Fourth argument must be a callback");
+            }
+
+            auto* worker = new StreamWorker<Stream>(info[3].As<Napi::Function>(), *stream_,
+                                                    args.chunk, args.offset, args.mode);
+            worker->Lease(this->Value(), busy_);
+            queueWork(worker, args.chunk.Length() - args.offset);
+            return env.Undefined();
+        }
+        catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    // Returns [output, consumed, done]
+    Napi::Value TransformSync(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        try {
+            StepArgs args = getStepArgs(info);
+            StreamStep step = stream_->step(args.chunk.Data(), args.chunk.Length(), args.offset, args.mode);
+
+            auto result = Napi::Array::New(env, 3);
+            result.Set(0u, step.output.toBuffer(env));
+            result.Set(1u, Napi::Number::New(env, static_cast<double>(step.consumed)));
+            result.Set(2u, Napi::Boolean::New(env, step.done));
+            return result;
+        }
+        catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    // Frees the context right away instead of waiting for GC
+    Napi::Value Close(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (busy_) {
+            Napi::Error::New(env, "Stream is busy with another operation").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        stream_.reset();
+        return env.Undefined();
+    }
+
+    bool busy_ = false;
+};
+
+// new CompressStream([levelOrOptions], [chunkSize])
+class CompressStream : public StreamHandle<CompressStream, StreamCompressor> {
+public:
+    static Napi::Function Define(Napi::Env env) {
+        return DefineClass(env, "CompressStream", Methods());
+    }
+
+    CompressStream(const Napi::CallbackInfo& info)
+        : StreamHandle<CompressStream, StreamCompressor>(info) {
+        Napi::Env env = info.Env();
+
+        try {
+            stream_ = std::make_unique<StreamCompressor>(getCompressOptions(info, 0), getWindowSize(info, 1));
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        }
+    }
+};
+
+// new DecompressStream([options], [chunkSize])
+class DecompressStream : public StreamHandle<DecompressStream, StreamDecompressor> {
+public:
+    static Napi::Function Define(Napi::Env env) {
+        return DefineClass(env, "DecompressStream", Methods());
+    }
+
+    DecompressStream(const Napi::CallbackInfo& info)
+        : StreamHandle<DecompressStream, StreamDecompressor>(info) {
+        Napi::Env env = info.Env();
+
+        try {
+            stream_ = std::make_unique<StreamDecompressor>(getDecompressOptions(info, 0), getWindowSize(info, 1));
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        }
+    }
+};
+
+// Addon instance data: one instance per environment that loads the module
+// (the main thread and each worker_thread), created by NODE_API_ADDON and
+// freed with its environment. Everything else the addon shares between
+// environments (pooled contexts, cached dictionaries) is immutable or
+// internally synchronized.
+class ZstdAddon : public Napi::Addon<ZstdAddon> {
+public:
+    ZstdAddon(Napi::Env env, Napi::Object exports) {
+        DefineAddon(exports, {
+            InstanceMethod("setMaxInputSize", &ZstdAddon::SetMaxInputSize, napi_enumerable),
+            InstanceMethod("setMaxOutputSize", &ZstdAddon::SetMaxOutputSize, napi_enumerable),
+            InstanceMethod("getLimits", &ZstdAddon::GetLimits, napi_enumerable)
+        });
+
+        exports.Set("zstdCompress", Napi::Function::New(env, Compress));
+        exports.Set("zstdDecompress", Napi::Function::New(env, Decompress));
+        exports.Set("zstdCompressSync", Napi::Function::New(env, CompressSync));
+        exports.Set("zstdDecompressSync", Napi::Function::New(env, DecompressSync));
+        exports.Set("compressInto", Napi::Function::New(env, CompressInto));
+        exports.Set("decompressInto", Napi::Function::New(env, DecompressInto));
+        exports.Set("compressBatch", Napi::Function::New(env, CompressBatch));
+        exports.Set("decompressBatch", Napi::Function::New(env, DecompressBatch));
+        exports.Set("compressDelta", Napi::Function::New(env, CompressDelta));
+        exports.Set("decompressDelta", Napi::Function::New(env, DecompressDelta));
+        exports.Set("compressFile", Napi::Function::New(env, CompressFile));
+        exports.Set("decompressFile", Napi::Function::New(env, DecompressFile));
+        exports.Set("compressSeekable", Napi::Function::New(env, CompressSeekable));
+        exports.Set("readRange", Napi::Function::New(env, ReadRange));
+        exports.Set("readRangeSync", Napi::Function::New(env, ReadRangeSync));
+        exports.Set("compressBound", Napi::Function::New(env, CompressBound));
+        exports.Set("trainDictionary", Napi::Function::New(env, TrainDictionary));
+        exports.Set("getStats", Napi::Function::New(env, GetStats));
+        exports.Set("getFrameInfo", Napi::Function::New(env, GetFrameInfo));
+        exports.Set("setMemoryBudget", Napi::Function::New(env, SetMemoryBudget));
+        exports.Set("getMemoryUsage", Napi::Function::New(env, GetMemoryUsage));
+        exports.Set("estimateMemory", Napi::Function::New(env, EstimateMemory));
+        exports.Set("configureContextArena", Napi::Function::New(env, ConfigureContextArena));
+        exports.Set("configureBufferPool", Napi::Function::New(env, ConfigureBufferPool));
+        exports.Set("configureThreadPool", Napi::Function::New(env, ConfigureThreadPool));
+        exports.Set("Dictionary", Dictionary::Define(env));
+        exports.Set("Compressor", Compressor::Define(env));
+        exports.Set("Decompressor", Decompressor::Define(env));
+        exports.Set("CompressStream", CompressStream::Define(env));
+        exports.Set("DecompressStream", DecompressStream::Define(env));
+
+        // Export constants
+        exports.Set("DEFAULT_LEVEL", Napi::Number::New(env, DEFAULT_LEVEL));
+        exports.Set("MIN_LEVEL", Napi::Number::New(env, ZSTD_minCLevel()));
+        exports.Set("MAX_LEVEL", Napi::Number::New(env, ZSTD_maxCLevel()));
+        exports.Set("MAX_WORKERS", Napi::Number::New(env, maxWorkers()));
+        exports.Set("FLUSH_CONTINUE", Napi::Number::New(env, ZSTD_e_continue));
+        exports.Set("FLUSH_FLUSH", Napi::Number::New(env, ZSTD_e_flush));
+        exports.Set("FLUSH_END", Napi::Number::New(env, ZSTD_e_end));
+    }
+
+    const SizeLimits& limits() const { return limits_; }
+
+    // Created on first use, so environments that never use the thread pool
+    // hold no threadsafe function
+    const PoolChannelPtr& poolChannel(Napi::Env env) {
+        if (!poolChannel_) {
+            auto channel = std::make_shared<PoolChannel>();
+            channel->tsfn = Napi::ThreadSafeFunction::New(
+                env, Napi::Function::New(env, [](const Napi::CallbackInfo&) {}), "zstdThreadPool", 0, 1);
+            channel->tsfn.Unref(env);
+            channel->open = true;
+            env.AddCleanupHook([channel] {
+                std::vector<Napi::AsyncWorker*> workers = threadPool().drop(channel);
+                {
+                    std::unique_lock<std::mutex> lock(channel->mutex);
+                    channel->open = false;
+                    channel->running -= workers.size();
+                    channel->idle.wait(lock, [&] { return channel->running == 0; });
+                    workers.insert(workers.end(), channel->done.begin(), channel->done.end());
+                    workers.insert(workers.end(), channel->orphans.begin(), channel->orphans.end());
+                    channel->done.clear();
+                    channel->orphans.clear();
+                    channel->pending = 0;
+                    channel->tsfn.Release();
+                }
+                // The environment is still alive here, so its references can
+                // be deleted; the Promises are never settled
+                for (Napi::AsyncWorker* worker : workers) {
+                    delete worker;
+                }
+            });
+            poolChannel_ = std::move(channel);
+        }
+        return poolChannel_;
+    }
+
+private:
+    // Config setter functions
+    Napi::Value SetMaxInputSize(const Napi::CallbackInfo& info) {
+        return setLimit(info, limits_.maxInput, "Input size limit");
+    }
+
+    Napi::Value SetMaxOutputSize(const Napi::CallbackInfo& info) {
+        return setLimit(info, limits_.maxOutput, "Output size limit");
+    }
+
+    Napi::Value GetLimits(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        auto result = Napi::Object::New(env);
+        result.Set("maxInputSize", Napi::Number::New(env, static_cast<double>(limits_.maxInput)));
+        result.Set("maxOutputSize", Napi::Number::New(env, static_cast<double>(limits_.maxOutput)));
+        return result;
+    }
+
+    static Napi::Value setLimit(const Napi::CallbackInfo& info, size_t& limit, const char* name) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsNumber()) {
+            Napi::TypeError::New(env, "Expected a number argument").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        try {
+            const int64_t value = info[0].As<Napi::Number>().Int64Value();
+            limit = safeConvertToSizeT(value, name);
+            return env.Undefined();
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    SizeLimits limits_ = { DEFAULT_MAX_INPUT_SIZE, DEFAULT_MAX_OUTPUT_SIZE };
+    PoolChannelPtr poolChannel_;
+};
+
+namespace {
+    SizeLimits currentLimits(Napi::Env env) {
+        return env.GetInstanceData<ZstdAddon>()->limits();
+    }
+
+    PoolChannelPtr poolChannel(Napi::Env env) {
+        return env.GetInstanceData<ZstdAddon>()->poolChannel(env);
+    }
 }
 
-NODE_API_MODULE(zstd_native, Init)
+NODE_API_ADDON(ZstdAddon)